@@ -0,0 +1,371 @@
+/*
+ *  Loopback latency and throughput benchmark for RioSockets
+ *  Copyright (c) 2020 Stanislav Denisov
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../riosockets.h"
+
+#ifndef _WIN32
+	#include <time.h>
+#endif
+
+#ifdef _WIN32
+	#define BENCHMARK_BACKEND "rio"
+#elif defined(RIOSOCKETS_BACKEND_POSIX)
+	#define BENCHMARK_BACKEND "posix"
+#else
+	#define BENCHMARK_BACKEND "io_uring"
+#endif
+
+#define BENCHMARK_WARMUP 100
+#define BENCHMARK_TIMEOUT 100000000
+#define BENCHMARK_WINDOW 128
+#define BENCHMARK_BURST_MESSAGES 256
+#define BENCHMARK_BURST_INTERVAL 1000000
+#define BENCHMARK_BURST_RECEIVE_BUFFER 65536
+#define BENCHMARK_BURST_MAX_SIZE 4096
+#define BENCHMARK_BUNDLE_LENGTH 1200
+#define BENCHMARK_BUNDLE_MAX_SIZE 256
+
+typedef struct _Benchmark {
+	RioSocket server;
+	RioSocket client;
+	RioAddress address;
+	uint64_t received;
+	uint64_t failed;
+} Benchmark;
+
+static Benchmark benchmark;
+
+static const int messageSizes[] = { 16, 64, 256, 1024, 4096, 16384, 65000 };
+static const int ringSizes[] = { 64 * 1024, 256 * 1024, 1024 * 1024 };
+static const int completionCounts[] = { 1, 16, 64, RIOSOCKETS_MAX_COMPLETION_RESULTS };
+
+static uint64_t benchmark_clock(void) {
+	#ifdef _WIN32
+		LARGE_INTEGER counter = { 0 };
+		LARGE_INTEGER frequency = { 0 };
+
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+
+		return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+	#else
+		struct timespec time = { 0 };
+
+		clock_gettime(CLOCK_MONOTONIC, &time);
+
+		return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+	#endif
+}
+
+static int benchmark_compare(const void* left, const void* right) {
+	uint64_t a = *(const uint64_t*)left;
+	uint64_t b = *(const uint64_t*)right;
+
+	return (a > b) - (a < b);
+}
+
+static double benchmark_percentile(const uint64_t* samples, int sampleCount, double percentile) {
+	int index = (int)(percentile * (sampleCount - 1) + 0.5);
+
+	return samples[index] / 1000.0;
+}
+
+static void benchmark_echo(RioSocket socket, const RioAddress* address, const uint8_t* data, int dataLength, RioType type) {
+	if (type == RIOSOCKETS_TYPE_RECEIVE) {
+		uint8_t* buffer = riosockets_buffer(socket, address, dataLength);
+
+		if (buffer != NULL)
+			memcpy(buffer, data, dataLength);
+	} else {
+		++benchmark.failed;
+	}
+}
+
+static void benchmark_count(RioSocket socket, const RioAddress* address, const uint8_t* data, int dataLength, RioType type) {
+	(void)socket;
+	(void)address;
+	(void)data;
+	(void)dataLength;
+
+	if (type == RIOSOCKETS_TYPE_RECEIVE)
+		++benchmark.received;
+	else
+		++benchmark.failed;
+}
+
+static int benchmark_open(int maxBufferLength, int ringSize, RioOptions* options, RioCallback serverCallback, RioCallback clientCallback) {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioAddress address = { 0 };
+	RioOptions serverOptions = { 0 };
+
+	memset(&benchmark, 0, sizeof(Benchmark));
+
+	// Bundling changes the datagram format, so the server has to unbundle what the client sends
+
+	serverOptions.maxBufferLength = maxBufferLength;
+	serverOptions.sendBufferSize = ringSize;
+	serverOptions.receiveBufferSize = ringSize;
+	serverOptions.callback = serverCallback;
+	serverOptions.flags = options->flags & RIOSOCKETS_FLAG_BUNDLE;
+
+	benchmark.server = riosockets_create_ex(&serverOptions, &error);
+
+	options->maxBufferLength = maxBufferLength;
+	options->sendBufferSize = ringSize;
+	options->receiveBufferSize = ringSize;
+	options->callback = clientCallback;
+
+	if (error == RIOSOCKETS_ERROR_NONE)
+		benchmark.client = riosockets_create_ex(options, &error);
+
+	if (error != RIOSOCKETS_ERROR_NONE) {
+		fprintf(stderr, "Skipping size %d with ring %d, socket creation failed with error code: %d\n", maxBufferLength, ringSize, error);
+
+		if (benchmark.server > 0)
+			riosockets_destroy(&benchmark.server);
+
+		return -1;
+	}
+
+	riosockets_address_set_ip(&address, "::1");
+
+	if (riosockets_bind(benchmark.server, &address) != 0 || riosockets_address_get(benchmark.server, &benchmark.address) != RIOSOCKETS_STATUS_OK) {
+		riosockets_destroy(&benchmark.server);
+		riosockets_destroy(&benchmark.client);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+static void benchmark_close(void) {
+	riosockets_destroy(&benchmark.server);
+	riosockets_destroy(&benchmark.client);
+}
+
+static void benchmark_latency(int messageSize, int ringSize, int maxCompletions, int iterations) {
+	RioOptions options = { 0 };
+
+	if (benchmark_open(messageSize, ringSize, &options, benchmark_echo, benchmark_count) != 0)
+		return;
+
+	uint64_t* samples = (uint64_t*)malloc(sizeof(uint64_t) * iterations);
+	int sampleCount = 0;
+	uint64_t lost = 0;
+
+	for (int i = 0; i < BENCHMARK_WARMUP + iterations; i++) {
+		uint8_t* buffer = riosockets_buffer(benchmark.client, &benchmark.address, messageSize);
+
+		if (buffer == NULL) {
+			riosockets_send(benchmark.client);
+
+			continue;
+		}
+
+		memset(buffer, (uint8_t)i, messageSize);
+
+		uint64_t expected = benchmark.received + 1;
+		uint64_t start = benchmark_clock();
+		uint64_t elapsed = 0;
+
+		riosockets_send(benchmark.client);
+
+		while (benchmark.received < expected && elapsed < BENCHMARK_TIMEOUT) {
+			riosockets_receive(benchmark.server, maxCompletions);
+			riosockets_send(benchmark.server);
+			riosockets_receive(benchmark.client, maxCompletions);
+
+			elapsed = benchmark_clock() - start;
+		}
+
+		riosockets_send(benchmark.client);
+
+		if (benchmark.received < expected) {
+			benchmark.received = expected;
+			++lost;
+		} else if (i >= BENCHMARK_WARMUP) {
+			samples[sampleCount++] = elapsed;
+		}
+	}
+
+	if (sampleCount > 0) {
+		qsort(samples, sampleCount, sizeof(uint64_t), benchmark_compare);
+
+		printf("latency,%s,%d,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%llu,,\n", BENCHMARK_BACKEND, messageSize, ringSize, maxCompletions, sampleCount, samples[0] / 1000.0, benchmark_percentile(samples, sampleCount, 0.5), benchmark_percentile(samples, sampleCount, 0.9), benchmark_percentile(samples, sampleCount, 0.99), benchmark_percentile(samples, sampleCount, 0.999), samples[sampleCount - 1] / 1000.0, (unsigned long long)lost);
+	}
+
+	free(samples);
+
+	benchmark_close();
+}
+
+static void benchmark_throughput(const char* test, int flags, int maxBufferLength, int messageSize, int ringSize, int maxCompletions, int messageCount) {
+	RioOptions options = { 0 };
+
+	options.flags = flags;
+	options.zeroCopyThreshold = 1;
+
+	if (benchmark_open(maxBufferLength, ringSize, &options, benchmark_count, benchmark_count) != 0)
+		return;
+
+	uint64_t sent = 0;
+	uint64_t start = benchmark_clock();
+	uint64_t last = start;
+
+	while (sent < (uint64_t)messageCount || (benchmark.received < sent && benchmark_clock() - last < BENCHMARK_TIMEOUT)) {
+		uint64_t received = benchmark.received;
+		uint8_t* buffer = NULL;
+
+		while (sent < (uint64_t)messageCount && sent - benchmark.received < BENCHMARK_WINDOW && (buffer = riosockets_buffer(benchmark.client, &benchmark.address, messageSize)) != NULL) {
+			memset(buffer, (uint8_t)sent, messageSize);
+
+			++sent;
+		}
+
+		riosockets_send(benchmark.client);
+		riosockets_receive(benchmark.server, maxCompletions);
+
+		if (benchmark.received != received)
+			last = benchmark_clock();
+	}
+
+	double seconds = (last - start) / 1000000000.0;
+
+	if (seconds > 0.0)
+		printf("%s,%s,%d,%d,%d,%llu,,,,,,,%llu,%.0f,%.2f\n", test, BENCHMARK_BACKEND, messageSize, ringSize, maxCompletions, (unsigned long long)benchmark.received, (unsigned long long)(sent - benchmark.received), benchmark.received / seconds, benchmark.received * messageSize * 8 / seconds / 1000000.0);
+
+	benchmark_close();
+}
+
+static void benchmark_burst(const char* test, int paced, int messageSize, int intervalCount) {
+	RioOptions options = { 0 };
+	int ringSize = (messageSize + 128) * BENCHMARK_BURST_MESSAGES * 2;
+	int receiveBuffer = BENCHMARK_BURST_RECEIVE_BUFFER;
+
+	// The paced rate matches the goodput of one burst per interval
+
+	if (paced)
+		options.pacingRate = (uint64_t)messageSize * BENCHMARK_BURST_MESSAGES * 1000000000 / BENCHMARK_BURST_INTERVAL;
+
+	if (benchmark_open(messageSize, ringSize, &options, benchmark_count, benchmark_count) != 0)
+		return;
+
+	riosockets_set_option(benchmark.server, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+	uint64_t sent = 0;
+	uint64_t start = benchmark_clock();
+	uint64_t last = start;
+
+	for (int i = 0; i < intervalCount; i++) {
+		uint64_t deadline = start + (uint64_t)(i + 1) * BENCHMARK_BURST_INTERVAL;
+		uint8_t* buffer = NULL;
+
+		for (int j = 0; j < BENCHMARK_BURST_MESSAGES && (buffer = riosockets_buffer(benchmark.client, &benchmark.address, messageSize)) != NULL; j++) {
+			memset(buffer, (uint8_t)sent, messageSize);
+
+			++sent;
+		}
+
+		do {
+			riosockets_send(benchmark.client);
+			riosockets_receive(benchmark.server, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+		} while (benchmark_clock() < deadline);
+	}
+
+	while (benchmark.received < sent && benchmark_clock() - last < BENCHMARK_TIMEOUT) {
+		uint64_t received = benchmark.received;
+
+		riosockets_send(benchmark.client);
+		riosockets_receive(benchmark.server, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+
+		if (benchmark.received != received)
+			last = benchmark_clock();
+	}
+
+	double seconds = (benchmark_clock() - start) / 1000000000.0;
+
+	printf("%s,%s,%d,%d,%d,%llu,,,,,,,%llu,%.0f,%.2f\n", test, BENCHMARK_BACKEND, messageSize, ringSize, RIOSOCKETS_MAX_COMPLETION_RESULTS, (unsigned long long)benchmark.received, (unsigned long long)(sent - benchmark.received), benchmark.received / seconds, benchmark.received * messageSize * 8 / seconds / 1000000.0);
+
+	benchmark_close();
+}
+
+int main(int argc, char** argv) {
+	int iterations = (argc > 1 ? atoi(argv[1]) : 10000);
+	int maxBufferLength = (argc > 2 ? atoi(argv[2]) : 1024);
+
+	if (iterations < 1 || maxBufferLength < 1) {
+		fprintf(stderr, "Usage: %s [iterations] [max buffer length]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (riosockets_initialize() != RIOSOCKETS_STATUS_OK) {
+		fprintf(stderr, "Initialization failed\n");
+
+		return 1;
+	}
+
+	printf("test,backend,size,ring,completions,messages,min_us,p50_us,p90_us,p99_us,p999_us,max_us,lost,pps,mbps\n");
+
+	for (int i = 0; i < (int)(sizeof(messageSizes) / sizeof(messageSizes[0])); i++) {
+		int messageSize = messageSizes[i];
+
+		if (messageSize > maxBufferLength) {
+			if (i > 0 && messageSizes[i - 1] >= maxBufferLength)
+				break;
+
+			messageSize = maxBufferLength;
+		}
+
+		for (int j = 0; j < (int)(sizeof(ringSizes) / sizeof(ringSizes[0])); j++) {
+			for (int k = 0; k < (int)(sizeof(completionCounts) / sizeof(completionCounts[0])); k++) {
+				benchmark_latency(messageSize, ringSizes[j], completionCounts[k], iterations);
+				benchmark_throughput("throughput", RIOSOCKETS_FLAG_NONE, messageSize, messageSize, ringSizes[j], completionCounts[k], iterations * 10);
+				benchmark_throughput("throughput_zerocopy", RIOSOCKETS_FLAG_ZEROCOPY, messageSize, messageSize, ringSizes[j], completionCounts[k], iterations * 10);
+			}
+		}
+
+		if (messageSize <= BENCHMARK_BURST_MAX_SIZE) {
+			benchmark_burst("burst", 0, messageSize, iterations / 10 + 1);
+			benchmark_burst("burst_paced", 1, messageSize, iterations / 10 + 1);
+		}
+
+		// Small messages to a single destination with and without bundling them into datagrams of the same maximum length
+
+		if (messageSize <= BENCHMARK_BUNDLE_MAX_SIZE) {
+			benchmark_throughput("small", RIOSOCKETS_FLAG_NONE, BENCHMARK_BUNDLE_LENGTH, messageSize, ringSizes[2], RIOSOCKETS_MAX_COMPLETION_RESULTS, iterations * 10);
+			benchmark_throughput("small_bundled", RIOSOCKETS_FLAG_BUNDLE, BENCHMARK_BUNDLE_LENGTH, messageSize, ringSizes[2], RIOSOCKETS_MAX_COMPLETION_RESULTS, iterations * 10);
+		}
+
+		fflush(stdout);
+	}
+
+	riosockets_deinitialize();
+
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ *  Receive dispatch benchmark for RioSockets
+ *  Copyright (c) 2020 Stanislav Denisov
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "../riosockets.hpp"
+
+#ifdef _WIN32
+	#define BENCHMARK_BACKEND "rio"
+#elif defined(RIOSOCKETS_BACKEND_POSIX)
+	#define BENCHMARK_BACKEND "posix"
+#else
+	#define BENCHMARK_BACKEND "io_uring"
+#endif
+
+#define BENCHMARK_TIMEOUT 100000000
+#define BENCHMARK_WINDOW 128
+#define BENCHMARK_WINDOW_BYTES 65536
+#define BENCHMARK_SETTLE 200000
+#define BENCHMARK_RING 1024 * 1024
+
+// Both paths run the same per-message work, only the dispatch differs
+
+static uint64_t checksum;
+static uint64_t received;
+
+static uint64_t benchmark_clock() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline static uint64_t benchmark_sum(const uint8_t* data, int dataLength) {
+	uint64_t sum = 0;
+
+	for (int i = 0; i < dataLength; i++) {
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+static void RIOSOCKETS_CALLBACK benchmark_callback(RioSocket, const RioAddress*, const uint8_t* data, int dataLength, RioType type) {
+	if (type == RIOSOCKETS_TYPE_RECEIVE) {
+		checksum += benchmark_sum(data, dataLength);
+
+		++received;
+	}
+}
+
+struct BenchmarkHandler {
+	template <typename Socket>
+	void operator()(Socket&, const RioMessage& message) noexcept {
+		checksum += benchmark_sum(message.data, message.dataLength);
+
+		++received;
+	}
+};
+
+template <int Length>
+struct BenchmarkFixedTraits : riosockets::SocketTraits {
+	static constexpr int messageLength = Length;
+};
+
+template <int Length>
+struct BenchmarkLeanTraits : BenchmarkFixedTraits<Length> {
+	static constexpr bool stats = false;
+	static constexpr bool peers = false;
+	static constexpr bool coalescing = false;
+	static constexpr bool bundle = false;
+	static constexpr bool sharedMemory = false;
+};
+
+template <int Length>
+struct BenchmarkFixedHandler {
+	template <typename Socket>
+	void operator()(Socket&, const RioMessage& message) noexcept {
+		checksum += benchmark_sum(message.data, Length);
+
+		++received;
+	}
+};
+
+// Each window is given time to arrive before it's drained and only the receive calls which delivered messages are timed
+
+template <typename Receive>
+static void benchmark_dispatch(const char* test, int messageSize, int messageCount, const RioAddress& address, Receive&& receive) {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioSocket client = riosockets_create(messageSize, BENCHMARK_RING, BENCHMARK_RING, benchmark_callback, &error);
+
+	if (error != RIOSOCKETS_ERROR_NONE) {
+		fprintf(stderr, "Skipping size %d, socket creation failed with error code: %d\n", messageSize, error);
+
+		return;
+	}
+
+	uint64_t sent = 0;
+	uint64_t elapsed = 0;
+	uint64_t last = benchmark_clock();
+	int window = (BENCHMARK_WINDOW_BYTES / messageSize < BENCHMARK_WINDOW ? BENCHMARK_WINDOW_BYTES / messageSize : BENCHMARK_WINDOW);
+
+	received = 0;
+
+	while (sent < (uint64_t)messageCount && benchmark_clock() - last < BENCHMARK_TIMEOUT) {
+		uint8_t* buffer = nullptr;
+
+		while (sent < (uint64_t)messageCount && sent - received < (uint64_t)window && (buffer = riosockets_buffer(client, &address, messageSize)) != nullptr) {
+			memset(buffer, (uint8_t)sent, messageSize);
+
+			++sent;
+		}
+
+		riosockets_send(client);
+
+		for (uint64_t settle = benchmark_clock(); benchmark_clock() - settle < BENCHMARK_SETTLE;) {
+			riosockets_send(client);
+		}
+
+		while (received < sent && benchmark_clock() - last < BENCHMARK_TIMEOUT) {
+			uint64_t start = benchmark_clock();
+
+			if (receive() > 0) {
+				last = benchmark_clock();
+				elapsed += last - start;
+			}
+		}
+	}
+
+	if (received > 0)
+		printf("%s,%s,%d,%llu,%llu,%.2f\n", test, BENCHMARK_BACKEND, messageSize, (unsigned long long)received, (unsigned long long)(sent - received), (double)elapsed / received);
+
+	riosockets_destroy(&client);
+}
+
+static int benchmark_bind(RioSocket socket, RioAddress* address) {
+	riosockets_address_set_ip(address, "::1");
+
+	if (riosockets_bind(socket, address) != 0 || riosockets_address_get(socket, address) != RIOSOCKETS_STATUS_OK)
+		return -1;
+
+	return 0;
+}
+
+static void benchmark_callback_path(int messageSize, int messageCount) {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioAddress address = { };
+	RioSocket server = riosockets_create(messageSize, BENCHMARK_RING, BENCHMARK_RING, benchmark_callback, &error);
+
+	if (error != RIOSOCKETS_ERROR_NONE || benchmark_bind(server, &address) != 0) {
+		if (server > 0)
+			riosockets_destroy(&server);
+
+		return;
+	}
+
+	benchmark_dispatch("dispatch_callback", messageSize, messageCount, address, [server]() {
+		uint64_t before = received;
+
+		riosockets_receive(server, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+
+		return (int)(received - before);
+	});
+
+	riosockets_destroy(&server);
+}
+
+template <typename Handler, typename Traits>
+static void benchmark_template_path(const char* test, int messageSize, int messageCount) {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = { };
+	RioAddress address = { };
+
+	options.maxBufferLength = messageSize;
+	options.sendBufferSize = BENCHMARK_RING;
+	options.receiveBufferSize = BENCHMARK_RING;
+
+	riosockets::SocketT<Handler, Traits> server(options, &error);
+
+	if (!server || benchmark_bind(server.native(), &address) != 0)
+		return;
+
+	benchmark_dispatch(test, messageSize, messageCount, address, [&server]() {
+		return server.receive();
+	});
+}
+
+template <int... Lengths>
+static void benchmark_run(int maxBufferLength, int messageCount, std::integer_sequence<int, Lengths...>) {
+	auto run = [&](auto length) {
+		constexpr int messageSize = decltype(length)::value;
+
+		if (messageSize > maxBufferLength)
+			return;
+
+		benchmark_callback_path(messageSize, messageCount);
+		benchmark_template_path<BenchmarkHandler, riosockets::SocketTraits>("dispatch_template", messageSize, messageCount);
+		benchmark_template_path<BenchmarkFixedHandler<messageSize>, BenchmarkFixedTraits<messageSize>>("dispatch_template_fixed", messageSize, messageCount);
+		benchmark_template_path<BenchmarkFixedHandler<messageSize>, BenchmarkLeanTraits<messageSize>>("dispatch_template_lean", messageSize, messageCount);
+
+		fflush(stdout);
+	};
+
+	(run(std::integral_constant<int, Lengths>()), ...);
+}
+
+int main(int argc, char** argv) {
+	int iterations = (argc > 1 ? atoi(argv[1]) : 10000);
+	int maxBufferLength = (argc > 2 ? atoi(argv[2]) : 1024);
+
+	if (iterations < 1 || maxBufferLength < 1) {
+		fprintf(stderr, "Usage: %s [iterations] [max buffer length]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (riosockets_initialize() != RIOSOCKETS_STATUS_OK) {
+		fprintf(stderr, "Initialization failed\n");
+
+		return 1;
+	}
+
+	printf("test,backend,size,messages,lost,ns_per_message\n");
+
+	benchmark_run(maxBufferLength, iterations * 10, std::integer_sequence<int, 16, 64, 256, 1024, 4096>());
+
+	riosockets_deinitialize();
+
+	return 0;
+}
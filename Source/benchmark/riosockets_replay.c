@@ -0,0 +1,281 @@
+/*
+ *  Capture replay tool for RioSockets
+ *  Copyright (c) 2020 Stanislav Denisov
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../riosockets.h"
+
+#ifndef _WIN32
+	#include <time.h>
+#endif
+
+#define REPLAY_RING 4 * 1024 * 1024
+#define REPLAY_MAX_LENGTH 65507
+#define REPLAY_DRAIN 100000000
+
+// Only files written by the capture stage are understood: native byte order, raw IPv6 packets with UDP headers
+
+#define REPLAY_PCAPNG_SECTION 0x0A0D0D0A
+#define REPLAY_PCAPNG_INTERFACE 1
+#define REPLAY_PCAPNG_PACKET 6
+#define REPLAY_PCAPNG_MAGIC 0x1A2B3C4D
+#define REPLAY_PCAPNG_LINKTYPE_IPV6 229
+#define REPLAY_HEADER_LENGTH 48
+
+static uint64_t replies;
+
+static uint64_t replay_clock(void) {
+	#ifdef _WIN32
+		LARGE_INTEGER counter = { 0 };
+		LARGE_INTEGER frequency = { 0 };
+
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+
+		return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+	#else
+		struct timespec time = { 0 };
+
+		clock_gettime(CLOCK_MONOTONIC, &time);
+
+		return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+	#endif
+}
+
+static uint32_t replay_read32(const uint8_t* source) {
+	uint32_t value = 0;
+
+	memcpy(&value, source, sizeof(value));
+
+	return value;
+}
+
+static uint16_t replay_read16(const uint8_t* source) {
+	uint16_t value = 0;
+
+	memcpy(&value, source, sizeof(value));
+
+	return value;
+}
+
+static void replay_callback(RioSocket socket, const RioAddress* address, const uint8_t* data, int dataLength, RioType type) {
+	(void)socket;
+	(void)address;
+	(void)data;
+	(void)dataLength;
+
+	if (type == RIOSOCKETS_TYPE_RECEIVE)
+		++replies;
+}
+
+static uint8_t* replay_load(const char* path, long* length) {
+	FILE* file = fopen(path, "rb");
+	uint8_t* data = NULL;
+
+	if (file == NULL)
+		return NULL;
+
+	if (fseek(file, 0, SEEK_END) == 0 && (*length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+		data = (uint8_t*)malloc(*length);
+
+		if (data != NULL && fread(data, 1, *length, file) != (size_t)*length) {
+			free(data);
+
+			data = NULL;
+		}
+	}
+
+	fclose(file);
+
+	return data;
+}
+
+// Returns the inbound UDP payload of a packet block and its timestamp in nanoseconds, or NULL for other blocks
+
+static const uint8_t* replay_packet(const uint8_t* block, uint32_t blockLength, uint64_t resolution, uint64_t* timestamp, int* dataLength) {
+	if (replay_read32(block) != REPLAY_PCAPNG_PACKET || blockLength < 32)
+		return NULL;
+
+	uint32_t packetLength = replay_read32(block + 20);
+	const uint8_t* options = block + 28 + ((packetLength + 3) & ~3u);
+
+	if (packetLength < REPLAY_HEADER_LENGTH || packetLength > blockLength - 32 || block[28] >> 4 != 6 || block[28 + 6] != 17)
+		return NULL;
+
+	while (options + 4 <= block + blockLength - 4 && replay_read16(options) != 0) {
+		uint16_t optionLength = replay_read16(options + 2);
+
+		if (replay_read16(options) == 2 && optionLength == 4 && (replay_read32(options + 4) & 3) == 2)
+			return NULL;
+
+		options += 4 + ((optionLength + 3) & ~3u);
+	}
+
+	*timestamp = (((uint64_t)replay_read32(block + 12) << 32) | replay_read32(block + 16)) * resolution;
+	*dataLength = (int)packetLength - REPLAY_HEADER_LENGTH;
+
+	return block + 28 + REPLAY_HEADER_LENGTH;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s <capture file> <ip> <port> [fast]\n", argv[0]);
+
+		return 1;
+	}
+
+	int fast = (argc > 4 && strcmp(argv[4], "fast") == 0);
+	long fileLength = 0;
+	uint8_t* file = replay_load(argv[1], &fileLength);
+
+	if (file == NULL || fileLength < 28 || replay_read32(file) != REPLAY_PCAPNG_SECTION || replay_read32(file + 8) != REPLAY_PCAPNG_MAGIC) {
+		fprintf(stderr, "Failed to read a capture from %s\n", argv[1]);
+
+		free(file);
+
+		return 1;
+	}
+
+	if (riosockets_initialize() != RIOSOCKETS_STATUS_OK) {
+		fprintf(stderr, "Initialization failed\n");
+
+		free(file);
+
+		return 1;
+	}
+
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioAddress address = { 0 };
+	RioSocket socket = riosockets_create(REPLAY_MAX_LENGTH, REPLAY_RING, REPLAY_RING, replay_callback, &error);
+
+	address.port = (uint16_t)atoi(argv[3]);
+
+	if (socket <= 0 || error != RIOSOCKETS_ERROR_NONE || riosockets_address_set_ip(&address, argv[2]) != RIOSOCKETS_STATUS_OK) {
+		fprintf(stderr, "Failed to create a socket for %s:%s, error code: %d\n", argv[2], argv[3], error);
+
+		if (socket > 0)
+			riosockets_destroy(&socket);
+
+		free(file);
+
+		return 1;
+	}
+
+	uint64_t resolution = 1000;
+	uint64_t first = 0;
+	uint64_t messages = 0;
+	uint64_t bytes = 0;
+	uint64_t start = replay_clock();
+	long offset = 0;
+
+	while (offset + 12 <= fileLength) {
+		const uint8_t* block = file + offset;
+		uint32_t blockLength = replay_read32(block + 4);
+		uint64_t timestamp = 0;
+		int dataLength = 0;
+
+		if (blockLength < 12 || blockLength > (uint32_t)(fileLength - offset))
+			break;
+
+		offset += blockLength;
+
+		// Interfaces without the resolution option use microseconds
+
+		if (replay_read32(block) == REPLAY_PCAPNG_INTERFACE && blockLength >= 20) {
+			const uint8_t* options = block + 16;
+
+			if (replay_read16(block + 8) != REPLAY_PCAPNG_LINKTYPE_IPV6) {
+				fprintf(stderr, "Unsupported link type %d\n", replay_read16(block + 8));
+
+				break;
+			}
+
+			resolution = 1000;
+
+			while (options + 4 <= block + blockLength - 4 && replay_read16(options) != 0) {
+				uint16_t optionLength = replay_read16(options + 2);
+
+				if (replay_read16(options) == 9 && optionLength == 1 && !(options[4] & 0x80)) {
+					resolution = 1;
+
+					for (int i = options[4]; i < 9; i++) {
+						resolution *= 10;
+					}
+				}
+
+				options += 4 + ((optionLength + 3) & ~3u);
+			}
+
+			continue;
+		}
+
+		const uint8_t* data = replay_packet(block, blockLength, resolution, &timestamp, &dataLength);
+		uint8_t* buffer = NULL;
+
+		if (data == NULL || dataLength > REPLAY_MAX_LENGTH)
+			continue;
+
+		if (messages == 0)
+			first = timestamp;
+
+		// With the original timing each message waits for its offset from the first one, otherwise the ring is flushed only when it's full
+
+		if (!fast) {
+			uint64_t deadline = start + (timestamp > first ? timestamp - first : 0);
+
+			while (replay_clock() < deadline) {
+				riosockets_send(socket);
+				riosockets_receive(socket, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+			}
+		}
+
+		while ((buffer = riosockets_buffer(socket, &address, dataLength)) == NULL) {
+			riosockets_send(socket);
+			riosockets_receive(socket, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+		}
+
+		memcpy(buffer, data, dataLength);
+
+		++messages;
+		bytes += dataLength;
+	}
+
+	riosockets_send(socket);
+
+	double seconds = (replay_clock() - start) / 1000000000.0;
+
+	for (uint64_t drain = replay_clock(); replay_clock() - drain < REPLAY_DRAIN;) {
+		riosockets_send(socket);
+		riosockets_receive(socket, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+	}
+
+	printf("Replayed %llu messages, %llu bytes in %.3f seconds, %.0f messages per second, %.2f Mbps, %llu replies\n", (unsigned long long)messages, (unsigned long long)bytes, seconds, (seconds > 0.0 ? messages / seconds : 0.0), (seconds > 0.0 ? bytes * 8 / seconds / 1000000.0 : 0.0), (unsigned long long)replies);
+
+	riosockets_destroy(&socket);
+	riosockets_deinitialize();
+	free(file);
+
+	return 0;
+}
@@ -24,25 +24,48 @@
 #ifndef RIOSOCKETS_H
 #define RIOSOCKETS_H
 
+#if defined(RIOSOCKETS_IMPLEMENTATION) && !defined(_WIN32) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE
+#endif
+
 #include <stdint.h>
-#include <ws2tcpip.h>
+
+#ifdef _WIN32
+	#include <ws2tcpip.h>
+#else
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+#endif
 
 #define RIOSOCKETS_VERSION_MAJOR 1
-#define RIOSOCKETS_VERSION_MINOR 0
-#define RIOSOCKETS_VERSION_PATCH 2
+#define RIOSOCKETS_VERSION_MINOR 1
+#define RIOSOCKETS_VERSION_PATCH 0
 
-#define RIOSOCKETS_CALLBACK __cdecl
+#ifdef _WIN32
+	#define RIOSOCKETS_CALLBACK __cdecl
+#else
+	#define RIOSOCKETS_CALLBACK
+#endif
 
 #ifdef RIOSOCKETS_DLL
-	#ifdef RIOSOCKETS_IMPLEMENTATION
-		#define RIOSOCKETS_API __declspec(dllexport)
+	#ifdef _WIN32
+		#ifdef RIOSOCKETS_IMPLEMENTATION
+			#define RIOSOCKETS_API __declspec(dllexport)
+		#else
+			#define RIOSOCKETS_API __declspec(dllimport)
+		#endif
 	#else
-		#define RIOSOCKETS_API __declspec(dllimport)
+		#define RIOSOCKETS_API __attribute__ ((visibility ("default")))
 	#endif
+#else
+	#define RIOSOCKETS_API extern
 #endif
 
 #define RIOSOCKETS_HOSTNAME_SIZE 1025
 #define RIOSOCKETS_MAX_COMPLETION_RESULTS 256
+#define RIOSOCKETS_MAX_GATHER_SEGMENTS 8
+#define RIOSOCKETS_MAX_WAIT_SOCKETS 32
+#define RIOSOCKETS_STATS_BATCH_BUCKETS 9
 
 // API
 
@@ -52,6 +75,8 @@ extern "C" {
 
 	typedef intptr_t RioSocket;
 
+	typedef intptr_t RioPool;
+
 	typedef enum _RioStatus {
 		RIOSOCKETS_STATUS_OK = 0,
 		RIOSOCKETS_STATUS_ERROR = -1
@@ -73,9 +98,38 @@ extern "C" {
 		RIOSOCKETS_ERROR_RIO_REQUEST_QUEUE = 7,
 		RIOSOCKETS_ERROR_RIO_BUFFER_CREATION = 8,
 		RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION = 9,
-		RIOSOCKETS_ERROR_RIO_BUFFER_ASSOCIATION = 10
+		RIOSOCKETS_ERROR_RIO_BUFFER_ASSOCIATION = 10,
+		RIOSOCKETS_ERROR_SOCKET_BINDING = 11,
+		RIOSOCKETS_ERROR_THREAD_CREATION = 12,
+		RIOSOCKETS_ERROR_POOL = 13,
+		RIOSOCKETS_ERROR_CAPTURE = 14,
+		RIOSOCKETS_ERROR_OPTIONS = 15
 	} RioError;
 
+	typedef enum _RioFlags {
+		RIOSOCKETS_FLAG_NONE = 0,
+		RIOSOCKETS_FLAG_GSO = 1 << 0,
+		RIOSOCKETS_FLAG_GRO = 1 << 1,
+		RIOSOCKETS_FLAG_NUMA = 1 << 2,
+		RIOSOCKETS_FLAG_CONCURRENT_SEND = 1 << 3,
+		RIOSOCKETS_FLAG_TIMESTAMP = 1 << 4,
+		RIOSOCKETS_FLAG_HUGE_PAGES = 1 << 5,
+		RIOSOCKETS_FLAG_ZEROCOPY = 1 << 6,
+		RIOSOCKETS_FLAG_CAPTURE_SEND = 1 << 7,
+		RIOSOCKETS_FLAG_SHARED_MEMORY = 1 << 8,
+		RIOSOCKETS_FLAG_BUNDLE = 1 << 9
+	} RioFlags;
+
+	typedef enum _RioFeatures {
+		RIOSOCKETS_FEATURE_NONE = 0,
+		RIOSOCKETS_FEATURE_STATS = 1 << 0,
+		RIOSOCKETS_FEATURE_PEERS = 1 << 1,
+		RIOSOCKETS_FEATURE_COALESCING = 1 << 2,
+		RIOSOCKETS_FEATURE_BUNDLE = 1 << 3,
+		RIOSOCKETS_FEATURE_SHARED_MEMORY = 1 << 4,
+		RIOSOCKETS_FEATURE_ALL = (1 << 5) - 1
+	} RioFeatures;
+
 	typedef struct _RioAddress {
 		union {
 			struct in6_addr ipv6;
@@ -90,12 +144,83 @@ extern "C" {
 
 	typedef void (RIOSOCKETS_CALLBACK *RioCallback)(RioSocket, const RioAddress*, const uint8_t*, int, RioType);
 
+	typedef struct _RioOptions {
+		int maxBufferLength;
+		int sendBufferSize;
+		int receiveBufferSize;
+		RioCallback callback;
+		int flags;
+		int numaNode;
+		RioPool pool;
+		int maxPeers;
+		int maxSegments;
+		int zeroCopyThreshold;
+		uint64_t pacingRate;
+		uint64_t pacingTotalRate;
+		int pacingBurst;
+		const char* captureFile;
+		uint64_t captureSize;
+		int sharedMemorySize;
+	} RioOptions;
+
+	typedef struct _RioPoolOptions {
+		int maxBufferLength;
+		int bufferCount;
+		int socketQuota;
+		int flags;
+		int numaNode;
+	} RioPoolOptions;
+
+	typedef struct _RioStats {
+		uint64_t coalescedBatches;
+		uint64_t coalescedMessages;
+		uint64_t sentMessages;
+		uint64_t sentBytes;
+		uint64_t receivedMessages;
+		uint64_t receivedBytes;
+		uint64_t sendRejections;
+		uint64_t sendFailures;
+		uint64_t sendPendingPeak;
+		uint64_t receiveHeldPeak;
+		uint64_t zeroCopyMessages;
+		uint64_t zeroCopyCopied;
+		uint64_t pacedMessages;
+		uint64_t capturedMessages;
+		uint64_t captureDrops;
+		uint64_t bundledMessages;
+		uint64_t completionBatches[RIOSOCKETS_STATS_BATCH_BUCKETS];
+	} RioStats;
+
+	#ifndef _WIN32
+		typedef intptr_t RioServer;
+
+		typedef struct _RioServerOptions {
+			RioOptions options;
+			RioAddress address;
+			int shardCount;
+			const int* processors;
+			const int* numaNodes;
+		} RioServerOptions;
+	#endif
+
+	typedef struct _RioMessage {
+		const uint8_t* data;
+		int dataLength;
+		int slot;
+		RioAddress address;
+		uint64_t timestamp;
+		int peer;
+		uint64_t dequeueTimestamp;
+	} RioMessage;
+
 	RIOSOCKETS_API RioStatus riosockets_initialize(void);
 
 	RIOSOCKETS_API void riosockets_deinitialize(void);
 
 	RIOSOCKETS_API RioSocket riosockets_create(int, int, int, RioCallback, RioError*);
 
+	RIOSOCKETS_API RioSocket riosockets_create_ex(const RioOptions*, RioError*);
+
 	RIOSOCKETS_API void riosockets_destroy(RioSocket*);
 
 	RIOSOCKETS_API int riosockets_bind(RioSocket, const RioAddress*);
@@ -108,10 +233,68 @@ extern "C" {
 
 	RIOSOCKETS_API uint8_t* riosockets_buffer(RioSocket, const RioAddress*, int);
 
+	RIOSOCKETS_API uint8_t* riosockets_buffer_ex(RioSocket, const RioAddress*, int, int);
+
+	RIOSOCKETS_API uint8_t* riosockets_buffer_peer(RioSocket, int, int);
+
+	RIOSOCKETS_API uint8_t* riosockets_buffer_fanout(RioSocket, const RioAddress*, int, int);
+
+	RIOSOCKETS_API uint8_t* riosockets_buffer_gather(RioSocket, const RioAddress*, int, const int*, int);
+
+	RIOSOCKETS_API uint8_t* riosockets_segment(RioSocket, int, int*);
+
+	RIOSOCKETS_API void riosockets_segment_release(RioSocket, int);
+
+	RIOSOCKETS_API uint8_t* riosockets_buffer_reserve(RioSocket, const RioAddress*, int, int*);
+
+	RIOSOCKETS_API void riosockets_buffer_publish(RioSocket, int);
+
 	RIOSOCKETS_API void riosockets_send(RioSocket);
 
 	RIOSOCKETS_API void riosockets_receive(RioSocket, int);
 
+	RIOSOCKETS_API int riosockets_wait(RioSocket, int);
+
+	RIOSOCKETS_API int riosockets_wait_any(const RioSocket*, int, int);
+
+	RIOSOCKETS_API int riosockets_receive_batch(RioSocket, RioMessage*, int);
+
+	RIOSOCKETS_API int riosockets_receive_batch_ex(RioSocket, RioMessage*, int, int);
+
+	RIOSOCKETS_API void riosockets_release_batch(RioSocket, const RioMessage*, int);
+
+	RIOSOCKETS_API int riosockets_retain(RioSocket);
+
+	RIOSOCKETS_API void riosockets_release(RioSocket, int);
+
+	RIOSOCKETS_API uint64_t riosockets_receive_timestamp(RioSocket);
+
+	RIOSOCKETS_API uint64_t riosockets_receive_dequeue_timestamp(RioSocket);
+
+	RIOSOCKETS_API int riosockets_receive_peer(RioSocket);
+
+	RIOSOCKETS_API int riosockets_peer_register(RioSocket, const RioAddress*);
+
+	RIOSOCKETS_API void riosockets_peer_remove(RioSocket, int);
+
+	RIOSOCKETS_API RioStatus riosockets_peer_address(RioSocket, int, RioAddress*);
+
+	RIOSOCKETS_API RioStatus riosockets_get_stats(RioSocket, RioStats*);
+
+	RIOSOCKETS_API RioPool riosockets_pool_create(const RioPoolOptions*, RioError*);
+
+	RIOSOCKETS_API void riosockets_pool_destroy(RioPool*);
+
+	RIOSOCKETS_API int riosockets_pool_available(RioPool);
+
+	#ifndef _WIN32
+		RIOSOCKETS_API RioServer riosockets_server_create(const RioServerOptions*, RioError*);
+
+		RIOSOCKETS_API void riosockets_server_destroy(RioServer*);
+
+		RIOSOCKETS_API RioSocket riosockets_server_socket(RioServer, int);
+	#endif
+
 	RIOSOCKETS_API RioStatus riosockets_address_get(RioSocket, RioAddress*);
 
 	RIOSOCKETS_API RioStatus riosockets_address_is_equal(const RioAddress*, const RioAddress*);
@@ -131,46 +314,367 @@ extern "C" {
 #if defined(RIOSOCKETS_IMPLEMENTATION) && !defined(RIOSOCKETS_IMPLEMENTATION_DONE)
 	#define RIOSOCKETS_IMPLEMENTATION_DONE 1
 
+	#include <stddef.h>
+	#include <stdlib.h>
 	#include <string.h>
-	#include <versionhelpers.h>
-	#include <mswsock.h>
 
-	#ifdef __MINGW32__
-		#include "mingw/rio.h"
+	#ifdef _WIN32
+		#define RIOSOCKETS_BACKEND_RIO 1
+
+		#include <versionhelpers.h>
+		#include <mswsock.h>
+
+		#ifdef __MINGW32__
+			#include "mingw/rio.h"
+		#endif
+	#else
+		#ifndef RIOSOCKETS_BACKEND_POSIX
+			#define RIOSOCKETS_BACKEND_IO_URING 1
+		#endif
+
+		#include <errno.h>
+		#include <fcntl.h>
+		#include <netdb.h>
+		#include <unistd.h>
+		#include <arpa/inet.h>
+		#include <sys/mman.h>
+		#include <sys/syscall.h>
+		#include <poll.h>
+		#include <time.h>
+		#include <sys/uio.h>
+		#include <netinet/udp.h>
+		#include <pthread.h>
+		#include <sched.h>
+		#include <signal.h>
+		#include <limits.h>
+		#include <sys/stat.h>
+		#include <sys/file.h>
+		#include <sys/un.h>
+
+		#ifdef RIOSOCKETS_BACKEND_IO_URING
+			#include <linux/io_uring.h>
+		#else
+			#include <linux/errqueue.h>
+		#endif
+
+		typedef int SOCKET;
+		typedef int BOOL;
+
+		typedef struct _RIO_BUF {
+			uint32_t BufferId;
+			uint32_t Offset;
+			uint32_t Length;
+		} RIO_BUF;
+
+		typedef union _SOCKADDR_INET {
+			struct sockaddr_in Ipv4;
+			struct sockaddr_in6 Ipv6;
+			sa_family_t si_family;
+		} SOCKADDR_INET;
+
+		#define TRUE 1
+		#define FALSE 0
+		#define INVALID_SOCKET -1
+
+		#define closesocket close
 	#endif
 
 	typedef struct _RioBuffer {
 		RIO_BUF data;
 		RIO_BUF address;
 		BOOL addressless;
+		BOOL completed;
+		int reservedLength;
+		int gatherCount;
+		uint64_t sequence;
 	} RioBuffer;
 
+	typedef struct _RioCompletion {
+		uint8_t* data;
+		const struct sockaddr_storage* address;
+		int dataLength;
+		int segmentLength;
+		int slot;
+		int peer;
+		uint64_t timestamp;
+	} RioCompletion;
+
+	typedef struct _RioPeerEntry {
+		uint64_t address[2];
+		uint32_t port;
+		int peer;
+	} RioPeerEntry;
+
+	typedef struct _RioPacingBucket {
+		RioPeerEntry key;
+		uint64_t time;
+	} RioPacingBucket;
+
+	typedef struct _RioPacer {
+		RioPacingBucket* buckets;
+		int* slots;
+		int* tails;
+		int* links;
+		uint64_t* ticks;
+		int* release;
+		int releaseCount;
+		int heldCount;
+		uint64_t tick;
+		uint64_t time;
+		uint64_t rate;
+		uint64_t totalRate;
+		uint64_t tolerance;
+		uint64_t totalTolerance;
+	} RioPacer;
+
+	typedef struct _RioBundle {
+		struct sockaddr_in6 address;
+		BOOL addressless;
+		int sendBufferIndex;
+	} RioBundle;
+
+	#ifdef RIOSOCKETS_BACKEND_IO_URING
+		typedef struct _RioRing {
+			int descriptor;
+			unsigned flags;
+			unsigned* sqHead;
+			unsigned* sqTail;
+			unsigned* sqFlags;
+			unsigned sqMask;
+			unsigned sqEntries;
+			unsigned sqLocalTail;
+			unsigned sqSubmitted;
+			unsigned* cqHead;
+			unsigned* cqTail;
+			unsigned cqMask;
+			struct io_uring_sqe* sqes;
+			struct io_uring_cqe* cqes;
+			void* ring;
+			size_t ringSize;
+			size_t sqesSize;
+		} RioRing;
+	#endif
+
+	typedef struct _RioArena {
+	#ifdef RIOSOCKETS_BACKEND_RIO
+		RIO_EXTENSION_FUNCTION_TABLE functions;
+		RIO_BUFFERID bufferId;
+	#endif
+		char* memory;
+		uint32_t* links;
+		int flags;
+		int numaNode;
+		int slotLength;
+		int slotCount;
+		int socketQuota;
+		uint8_t headPadding[64];
+		uint64_t head;
+		uint64_t available;
+	} RioArena;
+
+	typedef struct _RioCapture {
+	#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+	#else
+		int file;
+	#endif
+		uint8_t* memory;
+		uint64_t length;
+		uint64_t end;
+		uint64_t epoch;
+		RioAddress local;
+		RioAddress remote;
+		int queued;
+		uint8_t tailPadding[64];
+		uint64_t tail;
+	} RioCapture;
+
+	// The segment and lane layouts are shared between processes, the owner of a lane is a process identifier and a port
+
+	typedef struct _RioShmLane {
+		uint64_t owner;
+		uint8_t ownerPadding[56];
+		uint64_t tail;
+		uint8_t tailPadding[56];
+		uint64_t head;
+		uint8_t headPadding[56];
+	} RioShmLane;
+
+	typedef struct _RioShmSegment {
+		uint32_t magic;
+		uint32_t closed;
+		uint32_t laneCount;
+		uint32_t laneLength;
+		uint8_t headerPadding[48];
+		uint32_t waiting;
+		uint8_t waitingPadding[60];
+		RioShmLane lanes[1];
+	} RioShmSegment;
+
+	typedef struct _RioShmRecord {
+		uint32_t length;
+		uint16_t port;
+		uint16_t reserved;
+		int32_t references;
+		uint32_t padding;
+	} RioShmRecord;
+
+	typedef struct _RioShmPeer {
+		RioShmSegment* segment;
+		size_t length;
+		uint64_t laneLength;
+		uint64_t tail;
+		uint64_t retry;
+		int wakeFile;
+		int lane;
+		int pendingMessages;
+		uint64_t pendingBytes;
+		uint16_t port;
+	} RioShmPeer;
+
+	typedef struct _RioShm {
+		RioShmSegment* inbox;
+		size_t inboxLength;
+		int inboxFile;
+		int wakeFile;
+		BOOL socketFirst;
+		uint64_t* reads;
+		RioShmPeer* peers;
+		int peerCount;
+		int peerLast;
+		int laneNext;
+		int laneLength;
+		uint16_t port;
+		uint16_t remotePort;
+		BOOL remoteLoopback;
+	} RioShm;
+
 	typedef struct _Rio {
+	#ifdef RIOSOCKETS_BACKEND_RIO
 		RIO_EXTENSION_FUNCTION_TABLE functions;
 		RIO_CQ sendQueue;
 		RIO_CQ receiveQueue;
 		RIO_RQ requestQueue;
 		WSAEVENT sendEvent;
 		WSAEVENT receiveEvent;
-		SOCKET socket;
 		RIORESULT* sendCompletionResults;
 		RIORESULT* receiveCompletionResults;
+	#elif defined(RIOSOCKETS_BACKEND_IO_URING)
+		RioRing sendQueue;
+		RioRing receiveQueue;
+		struct io_uring_buf_ring* receiveBufferRing;
+		struct msghdr receiveMessage;
+		unsigned receiveBufferRingMask;
+		unsigned short receiveBufferRingTail;
+		int receiveBufferHeld;
+		BOOL receiveArmed;
+		BOOL sendFixed;
+		struct msghdr* sendMessages;
+		struct iovec* sendVectors;
+		struct iovec* sendGatherVectors;
+		char* sendControls;
+	#else
+		struct mmsghdr* sendMessages;
+		struct iovec* sendVectors;
+		char* sendControls;
+		struct mmsghdr* receiveMessages;
+		struct iovec* receiveVectors;
+		char* receiveControls;
+		int* receiveSlots;
+		int receiveBufferAvailable;
+		int* zeroCopyIndices;
+		uint32_t zeroCopyMask;
+		uint32_t zeroCopyNext;
+	#endif
+		SOCKET socket;
 		char* sendMemory;
-		char* sendMemoryAddress;
 		char* receiveMemory;
-		char* receiveMemoryAddress;
 		RioBuffer* sendBuffers;
 		RioBuffer* receiveBuffers;
+		RioCompletion* receiveCompletions;
+		int* receiveReferences;
+		RioArena* pool;
+		int* receiveIdle;
+		int receiveIdleCount;
+		int receiveTarget;
+		int poolHeld;
 		RioCallback callback;
+		int flags;
+		int numaNode;
 		int maxBufferLength;
+		int zeroCopyThreshold;
+		int sendMemoryLength;
+		int sendMemoryTail;
+		int sendMemoryUsed;
 		int sendBufferCount;
 		int sendBufferQueue;
 		int sendBufferTail;
 		int sendBufferPending;
 		int receiveBufferCount;
 		int receiveBufferHead;
+		int receiveBufferLength;
+		int receiveCompletionCount;
+		int receiveCompletionIndex;
+		int receiveCompletionOffset;
+		int receiveBundleOffset;
+		int receiveBufferUsed;
+		int receiveCallbackSlot;
+		uint64_t receiveCallbackTimestamp;
+		uint64_t receiveCallbackDequeueTimestamp;
+		uint64_t receiveDequeueTimestamp;
+		int receiveCallbackPeer;
+		RioPeerEntry* peerTable;
+		struct sockaddr_in6* peerAddresses;
+		int* peerFree;
+		int peerFreeCount;
+		int peerCapacity;
+		unsigned peerMask;
+		RioPacer* pacer;
+		RioCapture* capture;
+		RioShm* shm;
+		RioBundle* bundles;
+		int bundleCount;
+		int bundleNext;
+		char* segmentMemory;
+		int* segmentReferences;
+		int* segmentLengths;
+		int* segmentFree;
+		int segmentFreeCount;
+		int segmentCount;
+		int segmentLength;
+		uint64_t receiveArrival;
+		uint64_t receiveInterval;
+		int sendMemoryHead;
+		uint32_t sendTicket;
+		uint8_t sendReservePadding[64];
+		uint64_t sendReserveState;
+		uint8_t sendReclaimPadding[64];
+		uint64_t sendReclaimState;
+	#ifndef RIOSOCKETS_NO_STATS
+		uint8_t statsPadding[64];
+		RioStats stats;
+	#endif
 	} Rio;
 
+	#ifndef _WIN32
+		typedef struct _RioShard {
+			struct _RioShards* shards;
+			pthread_t thread;
+			RioSocket socket;
+			RioError error;
+			int index;
+			int state;
+		} RioShard;
+
+		typedef struct _RioShards {
+			RioServerOptions options;
+			RioShard* shards;
+			int shardCount;
+			int running;
+		} RioShards;
+	#endif
+
 	// Macros
 
 	#define RIOSOCKETS_HOST_TO_NET_16(value) (htons(value))
@@ -178,6 +682,138 @@ extern "C" {
 	#define RIOSOCKETS_NET_TO_HOST_16(value) (ntohs(value))
 	#define RIOSOCKETS_NET_TO_HOST_32(value) (ntohl(value))
 
+	#define RIOSOCKETS_SEND_ALIGNMENT 64
+
+	#ifndef RIOSOCKETS_WAIT_SPIN_LIMIT
+		#define RIOSOCKETS_WAIT_SPIN_LIMIT 50
+	#endif
+
+	#ifndef RIOSOCKETS_ZEROCOPY_THRESHOLD
+		#define RIOSOCKETS_ZEROCOPY_THRESHOLD 16384
+	#endif
+
+	#ifndef RIOSOCKETS_PACING_GRANULARITY
+		#define RIOSOCKETS_PACING_GRANULARITY 50000
+	#endif
+
+	#ifndef RIOSOCKETS_PACING_BUCKETS
+		#define RIOSOCKETS_PACING_BUCKETS 1024
+	#endif
+
+	#define RIOSOCKETS_PACING_INNER_SLOTS 256
+	#define RIOSOCKETS_PACING_OUTER_SLOTS 64
+
+	#ifndef RIOSOCKETS_CAPTURE_SIZE
+		#define RIOSOCKETS_CAPTURE_SIZE 67108864
+	#endif
+
+	#define RIOSOCKETS_PCAPNG_SECTION 0x0A0D0D0A
+	#define RIOSOCKETS_PCAPNG_INTERFACE 1
+	#define RIOSOCKETS_PCAPNG_PACKET 6
+	#define RIOSOCKETS_PCAPNG_MAGIC 0x1A2B3C4D
+	#define RIOSOCKETS_PCAPNG_LINKTYPE_IPV6 229
+	#define RIOSOCKETS_CAPTURE_PREAMBLE_LENGTH 60
+	#define RIOSOCKETS_CAPTURE_HEADER_LENGTH 48
+
+	#ifndef RIOSOCKETS_BUNDLE_DESTINATIONS
+		#define RIOSOCKETS_BUNDLE_DESTINATIONS 16
+	#endif
+
+	#define RIOSOCKETS_BUNDLE_MAGIC 0xB5
+	#define RIOSOCKETS_BUNDLE_VERSION 1
+	#define RIOSOCKETS_BUNDLE_HEADER 2
+	#define RIOSOCKETS_BUNDLE_FRAME 2
+
+	#ifndef RIOSOCKETS_SHM_PATH
+		#define RIOSOCKETS_SHM_PATH "/dev/shm/riosockets-"
+	#endif
+
+	#ifndef RIOSOCKETS_SHM_SIZE
+		#define RIOSOCKETS_SHM_SIZE 1048576
+	#endif
+
+	#ifndef RIOSOCKETS_SHM_LANES
+		#define RIOSOCKETS_SHM_LANES 16
+	#endif
+
+	#ifndef RIOSOCKETS_SHM_PEERS
+		#define RIOSOCKETS_SHM_PEERS 64
+	#endif
+
+	#define RIOSOCKETS_SHM_MAGIC 0x52494F53
+	#define RIOSOCKETS_SHM_ALIGNMENT 16
+	#define RIOSOCKETS_SHM_MAX_SIZE (1 << 26)
+	#define RIOSOCKETS_SHM_WRAP 0xFFFFFFFF
+	#define RIOSOCKETS_SHM_SLOT (1 << 30)
+	#define RIOSOCKETS_SHM_RETRY 1000000000
+
+	#ifdef _MSC_VER
+		#define RIOSOCKETS_ATOMIC_LOAD(pointer) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(pointer), 0, 0))
+		#define RIOSOCKETS_ATOMIC_STORE(pointer, value) InterlockedExchange64((volatile LONG64*)(pointer), (LONG64)(value))
+		#define RIOSOCKETS_ATOMIC_CAS(pointer, expected, desired) (InterlockedCompareExchange64((volatile LONG64*)(pointer), (LONG64)(desired), (LONG64)(expected)) == (LONG64)(expected))
+		#define RIOSOCKETS_ATOMIC_ADD(pointer, value) InterlockedExchangeAdd64((volatile LONG64*)(pointer), (LONG64)(value))
+		#define RIOSOCKETS_INLINE __forceinline static
+	#else
+		#define RIOSOCKETS_ATOMIC_LOAD(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+		#define RIOSOCKETS_ATOMIC_STORE(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+		#define RIOSOCKETS_ATOMIC_CAS(pointer, expected, desired) __atomic_compare_exchange_n((pointer), &(expected), (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+		#define RIOSOCKETS_ATOMIC_ADD(pointer, value) __atomic_fetch_add((pointer), (value), __ATOMIC_RELAXED)
+		#define RIOSOCKETS_INLINE inline static __attribute__ ((always_inline))
+	#endif
+
+	#ifndef RIOSOCKETS_NO_STATS
+		#define RIOSOCKETS_STATS_ADD(rio, counter, value) ((rio)->stats.counter += (uint64_t)(value))
+		#define RIOSOCKETS_STATS_PEAK(rio, counter, value) ((rio)->stats.counter = ((uint64_t)(value) > (rio)->stats.counter ? (uint64_t)(value) : (rio)->stats.counter))
+		#define RIOSOCKETS_STATS_ATOMIC_ADD(rio, counter, value) RIOSOCKETS_ATOMIC_ADD(&(rio)->stats.counter, (uint64_t)(value))
+	#else
+		#define RIOSOCKETS_STATS_ADD(rio, counter, value) ((void)0)
+		#define RIOSOCKETS_STATS_PEAK(rio, counter, value) ((void)0)
+		#define RIOSOCKETS_STATS_ATOMIC_ADD(rio, counter, value) ((void)0)
+	#endif
+
+	#ifndef RIOSOCKETS_BACKEND_RIO
+		#define RIOSOCKETS_MAX_NUMA_NODES 1024
+		#define RIOSOCKETS_MPOL_PREFERRED 1
+		#define RIOSOCKETS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+		#define RIOSOCKETS_SHARD_WAIT_TIMEOUT 10
+	#endif
+
+	#ifdef RIOSOCKETS_BACKEND_IO_URING
+		#ifndef RIOSOCKETS_SQPOLL_IDLE
+			#define RIOSOCKETS_SQPOLL_IDLE 100
+		#endif
+
+		#define RIOSOCKETS_RECEIVE_USER_DATA UINT64_MAX
+		#define RIOSOCKETS_RECEIVE_NAME_LENGTH 32
+		#define RIOSOCKETS_RECEIVE_HEADER_LENGTH (sizeof(struct io_uring_recvmsg_out) + RIOSOCKETS_RECEIVE_NAME_LENGTH)
+		#define RIOSOCKETS_RING_MAX_ENTRIES 32768
+	#endif
+
+	#ifdef RIOSOCKETS_BACKEND_POSIX
+		#define RIOSOCKETS_MAX_BATCH_MESSAGES 1024
+	#endif
+
+	#define RIOSOCKETS_POOL_EMPTY UINT32_MAX
+	#define RIOSOCKETS_POOL_RECEIVE_TARGET 4
+
+	#ifdef RIOSOCKETS_BACKEND_IO_URING
+		#define RIOSOCKETS_POOL_SLOT_OVERHEAD 128
+		#define RIOSOCKETS_POOL_ADDRESS_LENGTH 0
+	#else
+		#define RIOSOCKETS_POOL_SLOT_OVERHEAD 64
+		#define RIOSOCKETS_POOL_ADDRESS_LENGTH 32
+	#endif
+
+	#ifndef RIOSOCKETS_BACKEND_RIO
+		#define RIOSOCKETS_GSO_MAX_SEGMENTS 64
+		#define RIOSOCKETS_GSO_MAX_LENGTH 65000
+		#define RIOSOCKETS_SEGMENT_CONTROL_LENGTH CMSG_SPACE(sizeof(uint16_t))
+		#define RIOSOCKETS_GRO_MAX_SEGMENTS 64
+		#define RIOSOCKETS_GRO_MAX_LENGTH 65535
+		#define RIOSOCKETS_COALESCED_CONTROL_LENGTH CMSG_SPACE(sizeof(int))
+		#define RIOSOCKETS_TIMESTAMP_CONTROL_LENGTH CMSG_SPACE(sizeof(struct timespec))
+	#endif
+
 	// Functions
 
 	inline static uint64_t riosockets_round_and_divide(uint64_t value, uint64_t roundTo) {
@@ -188,6 +824,67 @@ extern "C" {
 		return riosockets_round_and_divide(value, roundTo) * roundTo;
 	}
 
+	inline static int riosockets_send_reservation(int dataLength, BOOL addressed) {
+		int reservedLength = (int)riosockets_round_up(riosockets_round_up(dataLength, 8) + (addressed ? sizeof(SOCKADDR_INET) : 0), RIOSOCKETS_SEND_ALIGNMENT);
+
+		return reservedLength > 0 ? reservedLength : RIOSOCKETS_SEND_ALIGNMENT;
+	}
+
+	inline static uint64_t riosockets_clock(void) {
+		#ifdef _WIN32
+			LARGE_INTEGER counter = { 0 };
+			LARGE_INTEGER frequency = { 0 };
+
+			QueryPerformanceCounter(&counter);
+			QueryPerformanceFrequency(&frequency);
+
+			return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+		#else
+			struct timespec time = { 0 };
+
+			clock_gettime(CLOCK_MONOTONIC, &time);
+
+			return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+		#endif
+	}
+
+	// Nanoseconds since the Unix epoch, the clock of kernel receive timestamps
+
+	inline static uint64_t riosockets_realtime(void) {
+		#ifdef _WIN32
+			FILETIME time = { 0 };
+
+			GetSystemTimePreciseAsFileTime(&time);
+
+			return ((((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) - 116444736000000000ULL) * 100;
+		#else
+			struct timespec time = { 0 };
+
+			clock_gettime(CLOCK_REALTIME, &time);
+
+			return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+		#endif
+	}
+
+	inline static int riosockets_stats_bucket(int completionCount) {
+		int bucket = 0;
+
+		while (completionCount > 1 && bucket < RIOSOCKETS_STATS_BATCH_BUCKETS - 1) {
+			completionCount >>= 1;
+			++bucket;
+		}
+
+		return bucket;
+	}
+
+	inline static uint64_t riosockets_receive_address_offset(const Rio* rio) {
+		return riosockets_round_up((uint64_t)rio->receiveBufferLength * rio->receiveBufferCount, 64);
+	}
+
+	inline static uint64_t riosockets_receive_region_length(const Rio* rio) {
+		return riosockets_receive_address_offset(rio) + sizeof(SOCKADDR_INET) * rio->receiveBufferCount;
+	}
+
 	inline static int riosockets_array_is_zeroed(const uint8_t* array, int length) {
 		for (size_t i = 0; i < length; i++) {
 			if (array[i] != 0)
@@ -221,418 +918,4566 @@ extern "C" {
 		return (s - source - 1);
 	}
 
-	inline static void riosockets_address_extract(RioAddress* address, const struct sockaddr_storage* source) {
-		if (source->ss_family == AF_INET) {
-			struct sockaddr_in* socketAddress = (struct sockaddr_in*)source;
+	// Address slots in the slabs aren't aligned for sockaddr_storage, so the address is copied out before it's read
 
+	inline static void riosockets_address_extract(RioAddress* address, const void* source) {
+		struct sockaddr_storage socketAddress;
+
+		memcpy(&socketAddress.ss_family, (const uint8_t*)source + offsetof(struct sockaddr_storage, ss_family), sizeof(socketAddress.ss_family));
+
+		if (socketAddress.ss_family == AF_INET) {
+			struct sockaddr_in* socketAddressIPv4 = (struct sockaddr_in*)&socketAddress;
+
+			memcpy(socketAddressIPv4, source, sizeof(struct sockaddr_in));
 			memset(address, 0, sizeof(address->ipv4.zeros));
 
 			address->ipv4.ffff = 0xFFFF;
-			address->ipv4.ip = socketAddress->sin_addr;
-			address->port = RIOSOCKETS_NET_TO_HOST_16(socketAddress->sin_port);
-		} else if (source->ss_family == AF_INET6) {
-			struct sockaddr_in6* socketAddress = (struct sockaddr_in6*)source;
+			address->ipv4.ip = socketAddressIPv4->sin_addr;
+			address->port = RIOSOCKETS_NET_TO_HOST_16(socketAddressIPv4->sin_port);
+		} else if (socketAddress.ss_family == AF_INET6) {
+			struct sockaddr_in6* socketAddressIPv6 = (struct sockaddr_in6*)&socketAddress;
+
+			memcpy(socketAddressIPv6, source, sizeof(struct sockaddr_in6));
 
-			address->ipv6 = socketAddress->sin6_addr;
-			address->port = RIOSOCKETS_NET_TO_HOST_16(socketAddress->sin6_port);
+			address->ipv6 = socketAddressIPv6->sin6_addr;
+			address->port = RIOSOCKETS_NET_TO_HOST_16(socketAddressIPv6->sin6_port);
 		}
 	}
 
-	static char* riosockets_buffer_allocate(uint64_t bufferLength, uint64_t bufferCount) {
-		SYSTEM_INFO systemInfo = { 0 };
+	inline static void riosockets_address_encode(struct sockaddr_in6* socketAddress, const RioAddress* address) {
+		memset(socketAddress, 0, sizeof(struct sockaddr_in6));
 
-		GetSystemInfo(&systemInfo);
-
-		return VirtualAlloc(NULL, riosockets_round_up(bufferLength * bufferCount, systemInfo.dwPageSize), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		socketAddress->sin6_family = AF_INET6;
+		socketAddress->sin6_addr = address->ipv6;
+		socketAddress->sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
 	}
 
-	static void riosockets_buffer_free(char* buffer) {
-		if (buffer != NULL)
-			VirtualFree(buffer, 0, MEM_RELEASE);
+	inline static void riosockets_peer_key(RioPeerEntry* entry, const struct sockaddr_in6* address) {
+		memcpy(entry->address, &address->sin6_addr, sizeof(entry->address));
+
+		entry->port = address->sin6_port;
 	}
 
-	RioStatus riosockets_initialize(void) {
-		WSADATA wsaData = { 0 };
+	inline static unsigned riosockets_peer_hash(const RioPeerEntry* entry) {
+		uint64_t hash = (entry->address[0] ^ (entry->address[1] * 0x9E3779B97F4A7C15ULL) ^ entry->port) * 0xBF58476D1CE4E5B9ULL;
 
-		if (WSAStartup(MAKEWORD(2, 2), &wsaData))
-			return RIOSOCKETS_STATUS_ERROR;
+		return (unsigned)(hash >> 32);
+	}
 
-		if (LOBYTE(wsaData.wVersion) != 2 || HIBYTE(wsaData.wVersion) != 2 || !IsWindows8OrGreater()) {
-			WSACleanup();
+	inline static BOOL riosockets_peer_match(const RioPeerEntry* left, const RioPeerEntry* right) {
+		return ((left->address[0] ^ right->address[0]) | (left->address[1] ^ right->address[1]) | (uint64_t)(left->port ^ right->port)) == 0;
+	}
 
-			return RIOSOCKETS_STATUS_ERROR;
+	inline static unsigned riosockets_peer_probe(const Rio* rio, const RioPeerEntry* key) {
+		unsigned index = riosockets_peer_hash(key) & rio->peerMask;
+
+		while (rio->peerTable[index].peer >= 0 && !riosockets_peer_match(&rio->peerTable[index], key)) {
+			index = (index + 1) & rio->peerMask;
 		}
 
-		return RIOSOCKETS_STATUS_OK;
+		return index;
 	}
 
-	void riosockets_deinitialize(void) {
-		WSACleanup();
-	}
+	// Receives only look senders up, so spoofed sources can't fill the registry, peers are added by the application
 
-	RioSocket riosockets_create(int maxBufferLength, int sendBufferSize, int receiveBufferSize, RioCallback callback, RioError* error) {
-		Rio* rio = NULL;
+	inline static int riosockets_peer_lookup(const Rio* rio, const struct sockaddr_in6* address) {
+		RioPeerEntry key = { 0 };
 
-		if (callback == NULL || error == NULL)
+		if (address->sin6_family != AF_INET6)
 			return -1;
 
-		SOCKET socket = WSASocketW(PF_INET6, SOCK_DGRAM, 0, NULL, 0, WSA_FLAG_REGISTERED_IO);
+		riosockets_peer_key(&key, address);
 
-		if (socket != INVALID_SOCKET) {
-			int onlyIPv6 = 0;
-
-			if (setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&onlyIPv6, sizeof(onlyIPv6)) != 0) {
-				closesocket(socket);
+		return rio->peerTable[riosockets_peer_probe(rio, &key)].peer;
+	}
 
-				*error = RIOSOCKETS_ERROR_SOCKET_DUAL_STACK;
+	static int riosockets_peer_find(Rio* rio, const struct sockaddr_in6* address) {
+		RioPeerEntry key = { 0 };
 
-				return -1;
-			}
+		if (address->sin6_family != AF_INET6)
+			return -1;
 
-			rio = (Rio*)calloc(1, sizeof(Rio));
+		riosockets_peer_key(&key, address);
 
-			rio->socket = socket;
-			rio->maxBufferLength = maxBufferLength;
-			rio->callback = callback;
+		unsigned index = riosockets_peer_probe(rio, &key);
 
-			GUID functionTableID = WSAID_MULTIPLE_RIO;
-			DWORD outBytes = 0;
+		if (rio->peerTable[index].peer >= 0)
+			return rio->peerTable[index].peer;
 
-			if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &functionTableID, sizeof(functionTableID), (void**)&rio->functions, sizeof(rio->functions), &outBytes, 0, 0) != 0) {
-				*error = RIOSOCKETS_ERROR_RIO_EXTENSION;
+		if (rio->peerFreeCount == 0)
+			return -1;
 
-				goto destroy;
-			}
+		key.peer = rio->peerFree[--rio->peerFreeCount];
+		rio->peerTable[index] = key;
 
-			if (sendBufferSize < rio->maxBufferLength || receiveBufferSize < rio->maxBufferLength) {
-				*error = RIOSOCKETS_ERROR_RIO_BUFFER_SIZE;
+		memset(&rio->peerAddresses[key.peer], 0, sizeof(struct sockaddr_in6));
 
-				goto destroy;
-			}
+		rio->peerAddresses[key.peer].sin6_family = AF_INET6;
+		rio->peerAddresses[key.peer].sin6_addr = address->sin6_addr;
+		rio->peerAddresses[key.peer].sin6_port = address->sin6_port;
 
-			rio->sendBufferCount = sendBufferSize / rio->maxBufferLength;
-			rio->receiveBufferCount = receiveBufferSize / rio->maxBufferLength;
+		return key.peer;
+	}
 
-			RIO_NOTIFICATION_COMPLETION sendQueue = { 0 };
+	static void riosockets_peer_erase(Rio* rio, unsigned index) {
+		unsigned next = index;
 
-			rio->sendEvent = WSACreateEvent();
+		rio->peerTable[index].peer = -1;
 
-			if (rio->sendEvent == WSA_INVALID_EVENT) {
-				*error = RIOSOCKETS_ERROR_RIO_EVENT;
+		for (;;) {
+			next = (next + 1) & rio->peerMask;
 
-				goto destroy;
-			}
+			if (rio->peerTable[next].peer < 0)
+				return;
 
-			rio->sendCompletionResults = calloc(rio->sendBufferCount, sizeof(RIORESULT));
+			unsigned home = riosockets_peer_hash(&rio->peerTable[next]) & rio->peerMask;
 
-			sendQueue.Type = RIO_EVENT_COMPLETION;
-			sendQueue.Event.EventHandle = rio->sendEvent;
+			// An entry can fill the gap only if its home slot doesn't lie cyclically between the gap and the entry
 
-			rio->sendQueue = rio->functions.RIOCreateCompletionQueue(rio->sendBufferCount, &sendQueue);
+			if ((index <= next) ? (index < home && home <= next) : (index < home || home <= next))
+				continue;
 
-			RIO_NOTIFICATION_COMPLETION receiveQueue = { 0 };
+			rio->peerTable[index] = rio->peerTable[next];
+			rio->peerTable[next].peer = -1;
 
-			rio->receiveEvent = WSACreateEvent();
+			index = next;
+		}
+	}
 
-			if (rio->receiveEvent == WSA_INVALID_EVENT) {
-				*error = RIOSOCKETS_ERROR_RIO_EVENT;
+	inline static int riosockets_send_head(const Rio* rio) {
+		int sendBufferHead = rio->sendBufferTail - rio->sendBufferQueue;
 
-				goto destroy;
-			}
+		return sendBufferHead < 0 ? sendBufferHead + rio->sendBufferCount : sendBufferHead;
+	}
 
-			rio->receiveCompletionResults = calloc(rio->receiveBufferCount, sizeof(RIORESULT));
+	inline static int riosockets_send_oldest(const Rio* rio) {
+		int sendBufferOldest = rio->sendBufferTail - rio->sendBufferQueue - rio->sendBufferPending;
 
-			receiveQueue.Type = RIO_EVENT_COMPLETION;
-			receiveQueue.Event.EventHandle = rio->receiveEvent;
+		return sendBufferOldest < 0 ? sendBufferOldest + rio->sendBufferCount : sendBufferOldest;
+	}
 
-			rio->receiveQueue = rio->functions.RIOCreateCompletionQueue(rio->receiveBufferCount, &receiveQueue);
+	static void riosockets_send_failure(Rio* rio, int sendBufferIndex) {
+		RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+		RioAddress address = { 0 };
 
-			if (rio->sendQueue == RIO_INVALID_CQ || rio->receiveQueue == RIO_INVALID_CQ) {
-				*error = RIOSOCKETS_ERROR_RIO_COMPLETION_QUEUE;
+		RIOSOCKETS_STATS_ADD(rio, sendFailures, 1);
 
-				goto destroy;
-			}
+		if (buffer->addressless == FALSE)
+			riosockets_address_extract(&address, (struct sockaddr_storage*)(rio->sendMemory + buffer->address.Offset));
 
-			rio->requestQueue = rio->functions.RIOCreateRequestQueue(socket, rio->receiveBufferCount, 1, rio->sendBufferCount, 1, rio->receiveQueue, rio->sendQueue, 0);
+		rio->callback((RioSocket)rio, (buffer->addressless == FALSE ? &address : NULL), (const uint8_t*)(rio->sendMemory + buffer->data.Offset), buffer->data.Length, RIOSOCKETS_TYPE_SEND);
+	}
 
-			if (rio->requestQueue == RIO_INVALID_RQ) {
-				*error = RIOSOCKETS_ERROR_RIO_REQUEST_QUEUE;
+	static int riosockets_pool_acquire(Rio* rio) {
+		RioArena* pool = rio->pool;
 
-				goto destroy;
-			}
+		if (rio->poolHeld >= pool->socketQuota)
+			return -1;
 
-			rio->sendMemory = riosockets_buffer_allocate(rio->maxBufferLength, rio->sendBufferCount);
-			rio->sendMemoryAddress = riosockets_buffer_allocate(sizeof(SOCKADDR_INET), rio->sendBufferCount);
+		for (;;) {
+			uint64_t head = RIOSOCKETS_ATOMIC_LOAD(&pool->head);
+			uint32_t slot = (uint32_t)head;
 
-			if (rio->sendMemory == NULL || rio->sendMemoryAddress == NULL) {
-				*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+			if (slot == RIOSOCKETS_POOL_EMPTY)
+				return -1;
 
-				goto destroy;
-			}
+			uint64_t next = (((head >> 32) + 1) << 32) | ((volatile uint32_t*)pool->links)[slot];
 
-			RIO_BUFFERID sendBufferID = rio->functions.RIORegisterBuffer(rio->sendMemory, rio->maxBufferLength * rio->sendBufferCount);
-			RIO_BUFFERID sendAddressBufferID = rio->functions.RIORegisterBuffer(rio->sendMemoryAddress, rio->sendBufferCount * sizeof(SOCKADDR_INET));
+			if (RIOSOCKETS_ATOMIC_CAS(&pool->head, head, next)) {
+				RIOSOCKETS_ATOMIC_ADD(&pool->available, (uint64_t)-1);
 
-			if (sendBufferID == RIO_INVALID_BUFFERID || sendAddressBufferID == RIO_INVALID_BUFFERID) {
-				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+				++rio->poolHeld;
 
-				goto destroy;
+				return (int)slot;
 			}
+		}
+	}
 
-			rio->sendBuffers = (RioBuffer*)calloc(rio->sendBufferCount, sizeof(RioBuffer));
+	static void riosockets_pool_return(Rio* rio, uint32_t offset) {
+		RioArena* pool = rio->pool;
+		uint32_t slot = offset / (uint32_t)pool->slotLength;
 
-			for (int i = 0; i < rio->sendBufferCount; ++i) {
-				RIO_BUF buffer = { 0 };
+		for (;;) {
+			uint64_t head = RIOSOCKETS_ATOMIC_LOAD(&pool->head);
 
-				buffer.BufferId = sendBufferID;
-				buffer.Offset = rio->maxBufferLength * i;
-				buffer.Length = rio->maxBufferLength;
+			((volatile uint32_t*)pool->links)[slot] = (uint32_t)head;
 
-				rio->sendBuffers[i].data = buffer;
+			if (RIOSOCKETS_ATOMIC_CAS(&pool->head, head, (((head >> 32) + 1) << 32) | slot))
+				break;
+		}
 
-				buffer.BufferId = sendAddressBufferID;
-				buffer.Offset = sizeof(SOCKADDR_INET) * i;
-				buffer.Length = sizeof(SOCKADDR_INET);
+		RIOSOCKETS_ATOMIC_ADD(&pool->available, 1);
 
-				rio->sendBuffers[i].address = buffer;
-			}
+		--rio->poolHeld;
+	}
 
-			rio->receiveMemory = riosockets_buffer_allocate(rio->maxBufferLength, rio->receiveBufferCount);
-			rio->receiveMemoryAddress = riosockets_buffer_allocate(sizeof(SOCKADDR_INET), rio->receiveBufferCount);
+	static BOOL riosockets_pool_receive(Rio* rio, int receiveBufferIndex) {
+		int slot = riosockets_pool_acquire(rio);
 
-			if (rio->receiveMemory == NULL || rio->receiveMemoryAddress == NULL) {
-				*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+		if (slot < 0)
+			return FALSE;
 
-				goto destroy;
-			}
+		RioBuffer* buffer = &rio->receiveBuffers[receiveBufferIndex];
 
-			RIO_BUFFERID receiveBufferID = rio->functions.RIORegisterBuffer(rio->receiveMemory, rio->maxBufferLength * rio->receiveBufferCount);
-			RIO_BUFFERID receiveAddressBufferID = rio->functions.RIORegisterBuffer(rio->receiveMemoryAddress, rio->receiveBufferCount * sizeof(SOCKADDR_INET));
+		buffer->data.Offset = (uint32_t)slot * rio->pool->slotLength;
+		buffer->address.Offset = buffer->data.Offset + rio->pool->slotLength - RIOSOCKETS_POOL_ADDRESS_LENGTH;
 
-			if (receiveBufferID == RIO_INVALID_BUFFERID || receiveAddressBufferID == RIO_INVALID_BUFFERID) {
-				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+		return TRUE;
+	}
 
-				goto destroy;
-			}
+	inline static void riosockets_pool_release(Rio* rio, int receiveBufferIndex) {
+		riosockets_pool_return(rio, rio->receiveBuffers[receiveBufferIndex].data.Offset);
 
-			rio->receiveBuffers = (RioBuffer*)calloc(rio->receiveBufferCount, sizeof(RioBuffer));
+		rio->receiveIdle[rio->receiveIdleCount++] = receiveBufferIndex;
+	}
 
-			for (int i = 0; i < rio->receiveBufferCount; ++i) {
-				RIO_BUF buffer = { 0 };
+	inline static int* riosockets_send_segments(const Rio* rio, const RioBuffer* buffer) {
+		return (int*)(rio->sendMemory + buffer->data.Offset + riosockets_round_up(buffer->data.Length, 8) + (buffer->addressless == FALSE ? sizeof(SOCKADDR_INET) : 0));
+	}
 
-				buffer.BufferId = receiveBufferID;
-				buffer.Offset = rio->maxBufferLength * i;
-				buffer.Length = rio->maxBufferLength;
+	inline static int riosockets_send_length(const Rio* rio, const RioBuffer* buffer) {
+		int dataLength = buffer->data.Length;
 
-				rio->receiveBuffers[i].data = buffer;
+		if (buffer->gatherCount != 0) {
+			const int* segments = riosockets_send_segments(rio, buffer);
 
-				buffer.BufferId = receiveAddressBufferID;
-				buffer.Offset = sizeof(SOCKADDR_INET) * i;
-				buffer.Length = sizeof(SOCKADDR_INET);
+			for (int i = 0; i < buffer->gatherCount; i++) {
+				dataLength += rio->segmentLengths[segments[i]];
+			}
+		}
 
-				rio->receiveBuffers[i].address = buffer;
+		return dataLength;
+	}
 
-				if (!rio->functions.RIOReceiveEx(rio->requestQueue, &rio->receiveBuffers[i].data, 1, NULL, &rio->receiveBuffers[i].address, NULL, NULL, 0, 0)) {
-					*error = RIOSOCKETS_ERROR_RIO_BUFFER_ASSOCIATION;
+	inline static void riosockets_segment_drop(Rio* rio, int segment) {
+		if (--rio->segmentReferences[segment] == 0)
+			rio->segmentFree[rio->segmentFreeCount++] = segment;
+	}
 
-					goto destroy;
-				}
-			}
+	// A bundle starts with a magic and a version byte, and each message of it is prefixed with its length in network byte order
 
-			goto create;
+	inline static uint8_t* riosockets_bundle_frame(uint8_t* buffer, int dataLength) {
+		uint16_t length = RIOSOCKETS_HOST_TO_NET_16((uint16_t)dataLength);
 
-			destroy:
+		memcpy(buffer, &length, sizeof(length));
 
-			riosockets_destroy((RioSocket*)&rio);
+		return buffer + RIOSOCKETS_BUNDLE_FRAME;
+	}
+
+	// Returns the length of the message at the offset of a datagram and moves the offset past it, or -1 if the rest of the datagram is malformed
+
+	inline static int riosockets_bundle_next(const uint8_t* datagram, int datagramLength, int* offset) {
+		uint16_t length = 0;
 
+		if (*offset + RIOSOCKETS_BUNDLE_FRAME > datagramLength)
 			return -1;
-		} else {
-			*error = RIOSOCKETS_ERROR_SOCKET_CREATION;
 
+		memcpy(&length, datagram + *offset, sizeof(length));
+
+		length = RIOSOCKETS_NET_TO_HOST_16(length);
+
+		if (*offset + RIOSOCKETS_BUNDLE_FRAME + length > datagramLength)
 			return -1;
-		}
 
-		create:
+		*offset += RIOSOCKETS_BUNDLE_FRAME + length;
 
-		return (RioSocket)rio;
+		return length;
 	}
 
-	void riosockets_destroy(RioSocket* socket) {
+	// Only a datagram with the header whose messages add up to its length exactly is a bundle, anything else is passed through as it is
+
+	inline static BOOL riosockets_bundle_valid(const uint8_t* datagram, int datagramLength) {
+		int offset = RIOSOCKETS_BUNDLE_HEADER;
+
+		if (datagramLength < RIOSOCKETS_BUNDLE_HEADER + RIOSOCKETS_BUNDLE_FRAME || datagram[0] != RIOSOCKETS_BUNDLE_MAGIC || datagram[1] != RIOSOCKETS_BUNDLE_VERSION)
+			return FALSE;
+
+		while (offset < datagramLength) {
+			if (riosockets_bundle_next(datagram, datagramLength, &offset) < 0)
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	inline static void riosockets_capture_write16(uint8_t* destination, uint16_t value) {
+		memcpy(destination, &value, sizeof(value));
+	}
+
+	inline static void riosockets_capture_write32(uint8_t* destination, uint32_t value) {
+		memcpy(destination, &value, sizeof(value));
+	}
+
+	inline static uint32_t riosockets_capture_length(int dataLength) {
+		return 44 + (uint32_t)riosockets_round_up(RIOSOCKETS_CAPTURE_HEADER_LENGTH + dataLength, 4);
+	}
+
+	static uint64_t riosockets_capture_epoch(void) {
+		return riosockets_realtime() - riosockets_clock();
+	}
+
+	// The file is truncated to the last complete block, so it remains a valid pcapng file when the capture is closed
+
+	static void riosockets_capture_close(RioCapture* capture) {
+		uint64_t length = (capture->end != 0 ? capture->end : (capture->tail < capture->length ? capture->tail : capture->length));
+
+		#ifdef _WIN32
+			if (capture->memory != NULL)
+				UnmapViewOfFile(capture->memory);
+
+			if (capture->mapping != NULL)
+				CloseHandle(capture->mapping);
+
+			if (capture->file != INVALID_HANDLE_VALUE) {
+				LARGE_INTEGER position = { 0 };
+
+				position.QuadPart = (LONGLONG)length;
+
+				if (SetFilePointerEx(capture->file, position, NULL, FILE_BEGIN))
+					SetEndOfFile(capture->file);
+
+				CloseHandle(capture->file);
+			}
+		#else
+			if (capture->memory != NULL)
+				munmap(capture->memory, capture->length);
+
+			if (capture->file >= 0) {
+				while (ftruncate(capture->file, (off_t)length) != 0 && errno == EINTR) {
+					continue;
+				}
+
+				close(capture->file);
+			}
+		#endif
+
+		free(capture);
+	}
+
+	static RioCapture* riosockets_capture_open(const char* path, uint64_t length) {
+		RioCapture* capture = (RioCapture*)calloc(1, sizeof(RioCapture));
+
+		#ifdef _WIN32
+			capture->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+			if (capture->file != INVALID_HANDLE_VALUE && length >= RIOSOCKETS_CAPTURE_PREAMBLE_LENGTH) {
+				capture->mapping = CreateFileMappingA(capture->file, NULL, PAGE_READWRITE, (DWORD)(length >> 32), (DWORD)length, NULL);
+
+				if (capture->mapping != NULL)
+					capture->memory = (uint8_t*)MapViewOfFile(capture->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)length);
+			}
+		#else
+			capture->file = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+			if (capture->file >= 0 && length >= RIOSOCKETS_CAPTURE_PREAMBLE_LENGTH && ftruncate(capture->file, (off_t)length) == 0) {
+				void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, capture->file, 0);
+
+				if (memory != MAP_FAILED)
+					capture->memory = (uint8_t*)memory;
+			}
+		#endif
+
+		if (capture->memory == NULL) {
+			riosockets_capture_close(capture);
+
+			return NULL;
+		}
+
+		uint8_t* block = capture->memory;
+
+		// Section header with an unspecified section length
+
+		riosockets_capture_write32(block, RIOSOCKETS_PCAPNG_SECTION);
+		riosockets_capture_write32(block + 4, 28);
+		riosockets_capture_write32(block + 8, RIOSOCKETS_PCAPNG_MAGIC);
+		riosockets_capture_write16(block + 12, 1);
+		riosockets_capture_write16(block + 14, 0);
+		memset(block + 16, 0xFF, 8);
+		riosockets_capture_write32(block + 24, 28);
+
+		// Interface description with raw IPv6 packets and nanosecond timestamps
+
+		block += 28;
+
+		riosockets_capture_write32(block, RIOSOCKETS_PCAPNG_INTERFACE);
+		riosockets_capture_write32(block + 4, 32);
+		riosockets_capture_write16(block + 8, RIOSOCKETS_PCAPNG_LINKTYPE_IPV6);
+		riosockets_capture_write16(block + 10, 0);
+		riosockets_capture_write32(block + 12, 0);
+		riosockets_capture_write16(block + 16, 9);
+		riosockets_capture_write16(block + 18, 1);
+		block[20] = 9;
+		memset(block + 21, 0, 3);
+		riosockets_capture_write32(block + 24, 0);
+		riosockets_capture_write32(block + 28, 32);
+
+		capture->length = length;
+		capture->tail = RIOSOCKETS_CAPTURE_PREAMBLE_LENGTH;
+		capture->epoch = riosockets_capture_epoch();
+
+		return capture;
+	}
+
+	// Appends of the send and receive paths may run on different threads, a batch reserves its space with a single atomic add
+
+	static uint8_t* riosockets_capture_reserve(Rio* rio, uint64_t length, int messageCount) {
+		RioCapture* capture = rio->capture;
+		uint64_t offset = RIOSOCKETS_ATOMIC_ADD(&capture->tail, length);
+
+		if (offset + length > capture->length) {
+			if (offset <= capture->length)
+				capture->end = offset;
+
+			RIOSOCKETS_STATS_ATOMIC_ADD(rio, captureDrops, messageCount);
+
+			return NULL;
+		}
+
+		RIOSOCKETS_STATS_ATOMIC_ADD(rio, capturedMessages, messageCount);
+
+		return capture->memory + offset;
+	}
+
+	// Writes an enhanced packet block with synthesized IPv6 and UDP headers and returns the location of the payload
+
+	static uint8_t* riosockets_capture_record(RioCapture* capture, uint8_t* block, const RioAddress* address, int dataLength, uint64_t timestamp, BOOL outbound) {
+		uint32_t blockLength = riosockets_capture_length(dataLength);
+		uint32_t packetLength = RIOSOCKETS_CAPTURE_HEADER_LENGTH + dataLength;
+		const RioAddress* source = (outbound ? &capture->local : address);
+		const RioAddress* destination = (outbound ? address : &capture->local);
+		uint8_t* packet = block + 28;
+		uint8_t* options = packet + riosockets_round_up(packetLength, 4);
+
+		riosockets_capture_write32(block, RIOSOCKETS_PCAPNG_PACKET);
+		riosockets_capture_write32(block + 4, blockLength);
+		riosockets_capture_write32(block + 8, 0);
+		riosockets_capture_write32(block + 12, (uint32_t)(timestamp >> 32));
+		riosockets_capture_write32(block + 16, (uint32_t)timestamp);
+		riosockets_capture_write32(block + 20, packetLength);
+		riosockets_capture_write32(block + 24, packetLength);
+
+		riosockets_capture_write32(packet, RIOSOCKETS_HOST_TO_NET_32(0x60000000));
+		riosockets_capture_write16(packet + 4, RIOSOCKETS_HOST_TO_NET_16((uint16_t)(8 + dataLength)));
+		packet[6] = IPPROTO_UDP;
+		packet[7] = 64;
+		memcpy(packet + 8, &source->ipv6, 16);
+		memcpy(packet + 24, &destination->ipv6, 16);
+		riosockets_capture_write16(packet + 40, RIOSOCKETS_HOST_TO_NET_16(source->port));
+		riosockets_capture_write16(packet + 42, RIOSOCKETS_HOST_TO_NET_16(destination->port));
+		riosockets_capture_write16(packet + 44, RIOSOCKETS_HOST_TO_NET_16((uint16_t)(8 + dataLength)));
+		riosockets_capture_write16(packet + 46, 0);
+		memset(packet + packetLength, 0, options - packet - packetLength);
+
+		// Direction flags, inbound or outbound
+
+		riosockets_capture_write16(options, 2);
+		riosockets_capture_write16(options + 2, 4);
+		riosockets_capture_write32(options + 4, (outbound ? 2 : 1));
+		riosockets_capture_write32(options + 8, 0);
+		riosockets_capture_write32(options + 12, blockLength);
+
+		return packet + RIOSOCKETS_CAPTURE_HEADER_LENGTH;
+	}
+
+	inline static void riosockets_capture_local(Rio* rio) {
+		if (rio->capture->local.port == 0)
+			riosockets_address_get((RioSocket)rio, &rio->capture->local);
+	}
+
+	static void riosockets_capture_receive(Rio* rio) {
+		uint64_t batchLength = 0;
+		int messageCount = 0;
+
+		for (int i = 0; i < rio->receiveCompletionCount; i++) {
+			const RioCompletion* completion = &rio->receiveCompletions[i];
+			int segmentLength = (completion->segmentLength > 0 ? completion->segmentLength : completion->dataLength);
+			int offset = 0;
+
+			do {
+				batchLength += riosockets_capture_length(completion->dataLength - offset < segmentLength ? completion->dataLength - offset : segmentLength);
+				offset += segmentLength;
+				++messageCount;
+			} while (offset < completion->dataLength);
+		}
+
+		uint8_t* block = riosockets_capture_reserve(rio, batchLength, messageCount);
+
+		if (block == NULL)
+			return;
+
+		riosockets_capture_local(rio);
+
+		uint64_t time = riosockets_clock() + rio->capture->epoch;
+
+		for (int i = 0; i < rio->receiveCompletionCount; i++) {
+			const RioCompletion* completion = &rio->receiveCompletions[i];
+			int segmentLength = (completion->segmentLength > 0 ? completion->segmentLength : completion->dataLength);
+			int offset = 0;
+			RioAddress address = { 0 };
+
+			riosockets_address_extract(&address, completion->address);
+
+			do {
+				int dataLength = (completion->dataLength - offset < segmentLength ? completion->dataLength - offset : segmentLength);
+
+				memcpy(riosockets_capture_record(rio->capture, block, &address, dataLength, (completion->timestamp != 0 ? completion->timestamp : time), FALSE), completion->data + offset, dataLength);
+
+				block += riosockets_capture_length(dataLength);
+				offset += segmentLength;
+			} while (offset < completion->dataLength);
+		}
+	}
+
+	// Only messages that were queued since the previous call are recorded, the rest of the queue was recorded before
+
+	static void riosockets_capture_send(Rio* rio) {
+		int messageCount = rio->sendBufferQueue - rio->capture->queued;
+		int first = rio->sendBufferTail - messageCount;
+		uint64_t batchLength = 0;
+
+		if (first < 0)
+			first += rio->sendBufferCount;
+
+		for (int i = 0, sendBufferIndex = first; i < messageCount; i++) {
+			batchLength += riosockets_capture_length(riosockets_send_length(rio, &rio->sendBuffers[sendBufferIndex]));
+
+			if (++sendBufferIndex == rio->sendBufferCount)
+				sendBufferIndex = 0;
+		}
+
+		uint8_t* block = riosockets_capture_reserve(rio, batchLength, messageCount);
+
+		if (block == NULL)
+			return;
+
+		riosockets_capture_local(rio);
+
+		uint64_t time = riosockets_clock() + rio->capture->epoch;
+
+		for (int i = 0, sendBufferIndex = first; i < messageCount; i++) {
+			const RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+			int dataLength = riosockets_send_length(rio, buffer);
+			RioAddress address = rio->capture->remote;
+
+			if (buffer->addressless == FALSE)
+				riosockets_address_extract(&address, (const struct sockaddr_storage*)(rio->sendMemory + buffer->address.Offset));
+
+			uint8_t* data = riosockets_capture_record(rio->capture, block, &address, dataLength, time, TRUE);
+
+			memcpy(data, rio->sendMemory + buffer->data.Offset, buffer->data.Length);
+
+			if (buffer->gatherCount != 0) {
+				const int* segments = riosockets_send_segments(rio, buffer);
+
+				data += buffer->data.Length;
+
+				for (int j = 0; j < buffer->gatherCount; j++) {
+					memcpy(data, rio->segmentMemory + (size_t)segments[j] * rio->segmentLength, rio->segmentLengths[segments[j]]);
+
+					data += rio->segmentLengths[segments[j]];
+				}
+			}
+
+			block += riosockets_capture_length(dataLength);
+
+			if (++sendBufferIndex == rio->sendBufferCount)
+				sendBufferIndex = 0;
+		}
+	}
+
+	static void riosockets_send_complete(Rio* rio, int sendBufferIndex) {
+		RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+
+		buffer->completed = TRUE;
+
+		if (buffer->gatherCount != 0) {
+			const int* segments = riosockets_send_segments(rio, buffer);
+
+			for (int i = 0; i < buffer->gatherCount; i++) {
+				riosockets_segment_drop(rio, segments[i]);
+			}
+
+			buffer->gatherCount = 0;
+		}
+
+		while (rio->sendBufferPending != 0) {
+			int sendBufferOldest = riosockets_send_oldest(rio);
+
+			if (rio->sendBuffers[sendBufferOldest].completed == FALSE)
+				break;
+
+			rio->sendBuffers[sendBufferOldest].completed = FALSE;
+
+			if (rio->pool != NULL) {
+				if (rio->sendBuffers[sendBufferOldest].reservedLength != 0)
+					riosockets_pool_return(rio, rio->sendBuffers[sendBufferOldest].data.Offset);
+			} else {
+				rio->sendMemoryUsed -= rio->sendBuffers[sendBufferOldest].reservedLength;
+				rio->sendMemoryHead = rio->sendBuffers[sendBufferOldest].data.Offset + rio->sendBuffers[sendBufferOldest].reservedLength;
+
+				if (rio->sendMemoryHead == rio->sendMemoryLength)
+					rio->sendMemoryHead = 0;
+			}
+
+			--rio->sendBufferPending;
+		}
+	}
+
+	#ifndef RIOSOCKETS_BACKEND_RIO
+		inline static BOOL riosockets_send_zerocopy(const Rio* rio, const RioBuffer* buffer) {
+			return (rio->flags & RIOSOCKETS_FLAG_ZEROCOPY) && buffer->gatherCount == 0 && (int)buffer->data.Length >= rio->zeroCopyThreshold;
+		}
+
+		static int riosockets_send_run(const Rio* rio, int sendBufferHead, int sendBufferQueue) {
+			const RioBuffer* first = &rio->sendBuffers[sendBufferHead];
+
+			if (!(rio->flags & RIOSOCKETS_FLAG_GSO) || riosockets_send_zerocopy(rio, first))
+				return 1;
+
+			const char* firstAddress = rio->sendMemory + first->address.Offset;
+			int segmentLength = first->data.Length;
+			int totalLength = segmentLength;
+			int segmentLimit = rio->sendBufferCount - sendBufferHead;
+			int segmentCount = 1;
+
+			if (segmentLimit > sendBufferQueue)
+				segmentLimit = sendBufferQueue;
+
+			if (segmentLimit > RIOSOCKETS_GSO_MAX_SEGMENTS)
+				segmentLimit = RIOSOCKETS_GSO_MAX_SEGMENTS;
+
+			if (segmentLength == 0 || first->gatherCount != 0)
+				return 1;
+
+			while (segmentCount < segmentLimit) {
+				const RioBuffer* buffer = &rio->sendBuffers[sendBufferHead + segmentCount];
+
+				if (buffer->data.Length == 0 || buffer->gatherCount != 0 || (int)buffer->data.Length > segmentLength || totalLength + (int)buffer->data.Length > RIOSOCKETS_GSO_MAX_LENGTH || buffer->addressless != first->addressless)
+					break;
+
+				if (buffer->addressless == FALSE && memcmp(rio->sendMemory + buffer->address.Offset, firstAddress, sizeof(struct sockaddr_in6)) != 0)
+					break;
+
+				totalLength += buffer->data.Length;
+
+				++segmentCount;
+
+				if ((int)buffer->data.Length < segmentLength)
+					break;
+			}
+
+			return segmentCount;
+		}
+
+		static int riosockets_send_gather(const Rio* rio, const RioBuffer* buffer, struct iovec* vectors) {
+			const int* segments = riosockets_send_segments(rio, buffer);
+
+			vectors[0].iov_base = rio->sendMemory + buffer->data.Offset;
+			vectors[0].iov_len = buffer->data.Length;
+
+			for (int i = 0; i < buffer->gatherCount; i++) {
+				vectors[i + 1].iov_base = rio->segmentMemory + (size_t)segments[i] * rio->segmentLength;
+				vectors[i + 1].iov_len = rio->segmentLengths[segments[i]];
+			}
+
+			return buffer->gatherCount + 1;
+		}
+
+		inline static void riosockets_send_segment(struct msghdr* message, char* control, int segmentLength) {
+			uint16_t segmentSize = (uint16_t)segmentLength;
+
+			message->msg_control = control;
+			message->msg_controllen = RIOSOCKETS_SEGMENT_CONTROL_LENGTH;
+
+			struct cmsghdr* header = CMSG_FIRSTHDR(message);
+
+			header->cmsg_level = SOL_UDP;
+			header->cmsg_type = UDP_SEGMENT;
+			header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+			memcpy(CMSG_DATA(header), &segmentSize, sizeof(uint16_t));
+		}
+
+		static void riosockets_backend_configure(Rio* rio) {
+			int segmentSize = 0;
+			int coalescing = 1;
+			int timestamping = 1;
+
+			if ((rio->flags & RIOSOCKETS_FLAG_GSO) && setsockopt(rio->socket, SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize)) != 0)
+				rio->flags &= ~RIOSOCKETS_FLAG_GSO;
+
+			if ((rio->flags & RIOSOCKETS_FLAG_GRO) && setsockopt(rio->socket, SOL_UDP, UDP_GRO, &coalescing, sizeof(coalescing)) != 0)
+				rio->flags &= ~RIOSOCKETS_FLAG_GRO;
+
+			if ((rio->flags & RIOSOCKETS_FLAG_TIMESTAMP) && setsockopt(rio->socket, SOL_SOCKET, SO_TIMESTAMPNS, &timestamping, sizeof(timestamping)) != 0)
+				rio->flags &= ~RIOSOCKETS_FLAG_TIMESTAMP;
+
+			#ifdef RIOSOCKETS_BACKEND_POSIX
+				int zeroCopy = 1;
+
+				if ((rio->flags & RIOSOCKETS_FLAG_ZEROCOPY) && setsockopt(rio->socket, SOL_SOCKET, SO_ZEROCOPY, &zeroCopy, sizeof(zeroCopy)) != 0)
+					rio->flags &= ~RIOSOCKETS_FLAG_ZEROCOPY;
+			#else
+				// A socket that fails before its rings are created must not close a descriptor it doesn't own
+
+				rio->sendQueue.descriptor = -1;
+				rio->receiveQueue.descriptor = -1;
+			#endif
+		}
+
+		inline static int riosockets_receive_capacity(const Rio* rio) {
+			if (rio->flags & RIOSOCKETS_FLAG_GRO) {
+				int coalescedLength = rio->maxBufferLength * RIOSOCKETS_GRO_MAX_SEGMENTS;
+
+				return coalescedLength < RIOSOCKETS_GRO_MAX_LENGTH ? coalescedLength : RIOSOCKETS_GRO_MAX_LENGTH;
+			}
+
+			return rio->maxBufferLength;
+		}
+
+		inline static int riosockets_receive_control_length(const Rio* rio) {
+			int controlLength = 0;
+
+			if (rio->flags & RIOSOCKETS_FLAG_GRO)
+				controlLength += RIOSOCKETS_COALESCED_CONTROL_LENGTH;
+
+			if (rio->flags & RIOSOCKETS_FLAG_TIMESTAMP)
+				controlLength += RIOSOCKETS_TIMESTAMP_CONTROL_LENGTH;
+
+			return controlLength;
+		}
+
+		static void riosockets_receive_control(RioCompletion* completion, void* control, size_t controlLength) {
+			struct msghdr message = { 0 };
+
+			message.msg_control = control;
+			message.msg_controllen = controlLength;
+
+			completion->segmentLength = 0;
+			completion->timestamp = 0;
+
+			for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) {
+				if (header->cmsg_level == SOL_UDP && header->cmsg_type == UDP_GRO) {
+					memcpy(&completion->segmentLength, CMSG_DATA(header), sizeof(int));
+				} else if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS) {
+					struct timespec time = { 0 };
+
+					memcpy(&time, CMSG_DATA(header), sizeof(struct timespec));
+
+					completion->timestamp = (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+				}
+			}
+		}
+	#endif
+
+	#ifdef RIOSOCKETS_BACKEND_RIO
+		// Registered I/O
+
+		static char* riosockets_buffer_allocate(int flags, int numaNode, uint64_t bufferLength, uint64_t bufferCount) {
+			SYSTEM_INFO systemInfo = { 0 };
+			SIZE_T largePageSize = GetLargePageMinimum();
+			DWORD preferredNode = (numaNode >= 0 ? (DWORD)numaNode : NUMA_NO_PREFERRED_NODE);
+			char* buffer = NULL;
+
+			GetSystemInfo(&systemInfo);
+
+			if ((flags & RIOSOCKETS_FLAG_HUGE_PAGES) && largePageSize > 0)
+				buffer = (char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, riosockets_round_up(bufferLength * bufferCount, largePageSize), MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE, preferredNode);
+
+			if (buffer == NULL)
+				buffer = (char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, riosockets_round_up(bufferLength * bufferCount, systemInfo.dwPageSize), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, preferredNode);
+
+			return buffer;
+		}
+
+		static void riosockets_buffer_free(int flags, char* buffer, uint64_t bufferLength, uint64_t bufferCount) {
+			if (buffer != NULL)
+				VirtualFree(buffer, 0, MEM_RELEASE);
+		}
+
+		inline static SOCKET riosockets_backend_socket(void) {
+			return WSASocketW(PF_INET6, SOCK_DGRAM, 0, NULL, 0, WSA_FLAG_REGISTERED_IO);
+		}
+
+		inline static void riosockets_backend_configure(Rio* rio) {
+			rio->flags &= ~(RIOSOCKETS_FLAG_GSO | RIOSOCKETS_FLAG_GRO | RIOSOCKETS_FLAG_TIMESTAMP | RIOSOCKETS_FLAG_ZEROCOPY);
+		}
+
+		inline static int riosockets_backend_receive_length(const Rio* rio) {
+			return rio->maxBufferLength;
+		}
+
+		static int riosockets_backend_register(RioArena* pool, RioError* error) {
+			GUID functionTableID = WSAID_MULTIPLE_RIO;
+			DWORD outBytes = 0;
+			SOCKET socket = riosockets_backend_socket();
+
+			if (socket == INVALID_SOCKET) {
+				*error = RIOSOCKETS_ERROR_SOCKET_CREATION;
+
+				return -1;
+			}
+
+			if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &functionTableID, sizeof(functionTableID), (void**)&pool->functions, sizeof(pool->functions), &outBytes, 0, 0) != 0) {
+				closesocket(socket);
+
+				*error = RIOSOCKETS_ERROR_RIO_EXTENSION;
+
+				return -1;
+			}
+
+			closesocket(socket);
+
+			pool->bufferId = pool->functions.RIORegisterBuffer(pool->memory, (DWORD)((uint64_t)pool->slotLength * pool->slotCount));
+
+			if (pool->bufferId == RIO_INVALID_BUFFERID) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+
+				return -1;
+			}
+
+			return 0;
+		}
+
+		static int riosockets_backend_create(Rio* rio, RioError* error) {
+			GUID functionTableID = WSAID_MULTIPLE_RIO;
+			DWORD outBytes = 0;
+
+			if (WSAIoctl(rio->socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &functionTableID, sizeof(functionTableID), (void**)&rio->functions, sizeof(rio->functions), &outBytes, 0, 0) != 0) {
+				*error = RIOSOCKETS_ERROR_RIO_EXTENSION;
+
+				return -1;
+			}
+
+			rio->sendQueue = RIO_INVALID_CQ;
+			rio->receiveQueue = RIO_INVALID_CQ;
+
+			RIO_NOTIFICATION_COMPLETION sendQueue = { 0 };
+
+			rio->sendEvent = WSACreateEvent();
+
+			if (rio->sendEvent == WSA_INVALID_EVENT) {
+				*error = RIOSOCKETS_ERROR_RIO_EVENT;
+
+				return -1;
+			}
+
+			rio->sendCompletionResults = calloc(rio->sendBufferCount, sizeof(RIORESULT));
+
+			sendQueue.Type = RIO_EVENT_COMPLETION;
+			sendQueue.Event.EventHandle = rio->sendEvent;
+
+			rio->sendQueue = rio->functions.RIOCreateCompletionQueue(rio->sendBufferCount, &sendQueue);
+
+			RIO_NOTIFICATION_COMPLETION receiveQueue = { 0 };
+
+			rio->receiveEvent = WSACreateEvent();
+
+			if (rio->receiveEvent == WSA_INVALID_EVENT) {
+				*error = RIOSOCKETS_ERROR_RIO_EVENT;
+
+				return -1;
+			}
+
+			rio->receiveCompletionResults = calloc(RIOSOCKETS_MAX_COMPLETION_RESULTS, sizeof(RIORESULT));
+
+			receiveQueue.Type = RIO_EVENT_COMPLETION;
+			receiveQueue.Event.EventHandle = rio->receiveEvent;
+			receiveQueue.Event.NotifyReset = TRUE;
+
+			rio->receiveQueue = rio->functions.RIOCreateCompletionQueue(rio->receiveBufferCount, &receiveQueue);
+
+			if (rio->sendQueue == RIO_INVALID_CQ || rio->receiveQueue == RIO_INVALID_CQ) {
+				*error = RIOSOCKETS_ERROR_RIO_COMPLETION_QUEUE;
+
+				return -1;
+			}
+
+			rio->requestQueue = rio->functions.RIOCreateRequestQueue(rio->socket, rio->receiveBufferCount, 1, rio->sendBufferCount, 1, rio->receiveQueue, rio->sendQueue, 0);
+
+			if (rio->requestQueue == RIO_INVALID_RQ) {
+				*error = RIOSOCKETS_ERROR_RIO_REQUEST_QUEUE;
+
+				return -1;
+			}
+
+			if (rio->pool != NULL) {
+				rio->sendMemory = rio->pool->memory;
+				rio->receiveMemory = rio->pool->memory;
+			} else {
+				rio->sendMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, rio->sendMemoryLength, 1);
+				rio->receiveMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, riosockets_receive_region_length(rio), 1);
+			}
+
+			if (rio->sendMemory == NULL || rio->receiveMemory == NULL) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+
+				return -1;
+			}
+
+			RIO_BUFFERID sendBufferID = (rio->pool != NULL ? rio->pool->bufferId : rio->functions.RIORegisterBuffer(rio->sendMemory, rio->sendMemoryLength));
+
+			if (sendBufferID == RIO_INVALID_BUFFERID) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+
+				return -1;
+			}
+
+			rio->sendBuffers = (RioBuffer*)calloc(rio->sendBufferCount, sizeof(RioBuffer));
+
+			for (int i = 0; i < rio->sendBufferCount; ++i) {
+				rio->sendBuffers[i].data.BufferId = sendBufferID;
+				rio->sendBuffers[i].address.BufferId = sendBufferID;
+				rio->sendBuffers[i].address.Length = sizeof(SOCKADDR_INET);
+			}
+
+			RIO_BUFFERID receiveBufferID = (rio->pool != NULL ? rio->pool->bufferId : rio->functions.RIORegisterBuffer(rio->receiveMemory, (DWORD)riosockets_receive_region_length(rio)));
+
+			if (receiveBufferID == RIO_INVALID_BUFFERID) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+
+				return -1;
+			}
+
+			rio->receiveBuffers = (RioBuffer*)calloc(rio->receiveBufferCount, sizeof(RioBuffer));
+
+			for (int i = 0; i < rio->receiveBufferCount; ++i) {
+				RIO_BUF buffer = { 0 };
+
+				buffer.BufferId = receiveBufferID;
+				buffer.Offset = rio->receiveBufferLength * i;
+				buffer.Length = rio->receiveBufferLength;
+
+				rio->receiveBuffers[i].data = buffer;
+
+				buffer.Offset = (ULONG)riosockets_receive_address_offset(rio) + sizeof(SOCKADDR_INET) * i;
+				buffer.Length = sizeof(SOCKADDR_INET);
+
+				rio->receiveBuffers[i].address = buffer;
+
+				if (rio->pool == NULL && !rio->functions.RIOReceiveEx(rio->requestQueue, &rio->receiveBuffers[i].data, 1, NULL, &rio->receiveBuffers[i].address, NULL, NULL, 0, (PVOID)(intptr_t)i)) {
+					*error = RIOSOCKETS_ERROR_RIO_BUFFER_ASSOCIATION;
+
+					return -1;
+				}
+			}
+
+			return 0;
+		}
+
+		static void riosockets_backend_destroy(Rio* rio) {
+			if (rio->pool == NULL && rio->sendBuffers != NULL)
+				rio->functions.RIODeregisterBuffer(rio->sendBuffers[0].data.BufferId);
+
+			if (rio->pool == NULL && rio->receiveBuffers != NULL)
+				rio->functions.RIODeregisterBuffer(rio->receiveBuffers[0].data.BufferId);
+
+			if (rio->sendQueue != RIO_INVALID_CQ)
+				rio->functions.RIOCloseCompletionQueue(rio->sendQueue);
+
+			if (rio->receiveQueue != RIO_INVALID_CQ)
+				rio->functions.RIOCloseCompletionQueue(rio->receiveQueue);
+
+			if (rio->sendEvent != NULL)
+				WSACloseEvent(rio->sendEvent);
+
+			if (rio->receiveEvent != NULL)
+				WSACloseEvent(rio->receiveEvent);
+
+			closesocket(rio->socket);
+
+			if (rio->pool == NULL) {
+				riosockets_buffer_free(rio->flags, rio->sendMemory, rio->sendMemoryLength, 1);
+				riosockets_buffer_free(rio->flags, rio->receiveMemory, riosockets_receive_region_length(rio), 1);
+			}
+
+			free(rio->sendCompletionResults);
+			free(rio->receiveCompletionResults);
+		}
+
+		static void riosockets_send_submit(Rio* rio, int sendBufferIndex) {
+			RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+
+			if (!rio->functions.RIOSendEx(rio->requestQueue, &buffer->data, 1, NULL, (buffer->addressless == FALSE ? &buffer->address : NULL), NULL, NULL, RIO_MSG_DEFER, (PVOID)(intptr_t)sendBufferIndex)) {
+				riosockets_send_failure(rio, sendBufferIndex);
+				riosockets_send_complete(rio, sendBufferIndex);
+			}
+		}
+
+		static void riosockets_backend_send(Rio* rio) {
+			while (rio->sendBufferQueue != 0) {
+				int sendBufferHead = riosockets_send_head(rio);
+
+				--rio->sendBufferQueue;
+				++rio->sendBufferPending;
+
+				riosockets_send_submit(rio, sendBufferHead);
+			}
+
+			rio->functions.RIOSendEx(rio->requestQueue, NULL, 0, NULL, NULL, NULL, NULL, RIO_MSG_COMMIT_ONLY, NULL);
+		}
+
+		static int riosockets_backend_release(Rio* rio, const int* sendBufferIndices, int sendBufferCount) {
+			for (int i = 0; i < sendBufferCount; i++) {
+				riosockets_send_submit(rio, sendBufferIndices[i]);
+			}
+
+			rio->functions.RIOSendEx(rio->requestQueue, NULL, 0, NULL, NULL, NULL, NULL, RIO_MSG_COMMIT_ONLY, NULL);
+
+			return sendBufferCount;
+		}
+
+		static void riosockets_backend_complete(Rio* rio) {
+			ULONG completionCount = rio->functions.RIODequeueCompletion(rio->sendQueue, rio->sendCompletionResults, rio->sendBufferCount);
+
+			if (completionCount == RIO_CORRUPT_CQ)
+				return;
+
+			for (ULONG i = 0; i < completionCount; i++) {
+				int sendBufferIndex = (int)rio->sendCompletionResults[i].RequestContext;
+
+				if (rio->sendCompletionResults[i].Status != 0) {
+					riosockets_send_failure(rio, sendBufferIndex);
+				} else {
+					RIOSOCKETS_STATS_ADD(rio, sentMessages, 1);
+					RIOSOCKETS_STATS_ADD(rio, sentBytes, riosockets_send_length(rio, &rio->sendBuffers[sendBufferIndex]));
+				}
+
+				riosockets_send_complete(rio, sendBufferIndex);
+			}
+		}
+
+		static int riosockets_backend_receive(Rio* rio, RioCompletion* completions, int maxCompletions) {
+			ULONG completionCount = rio->functions.RIODequeueCompletion(rio->receiveQueue, rio->receiveCompletionResults, maxCompletions);
+
+			if (completionCount == RIO_CORRUPT_CQ)
+				return 0;
+
+			for (ULONG i = 0; i < completionCount; i++) {
+				int receiveBufferIndex = (int)rio->receiveCompletionResults[i].RequestContext;
+
+				completions[i].data = (uint8_t*)(rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].data.Offset);
+				completions[i].address = (const struct sockaddr_storage*)(rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].address.Offset);
+				completions[i].dataLength = rio->receiveCompletionResults[i].BytesTransferred;
+				completions[i].segmentLength = 0;
+				completions[i].slot = receiveBufferIndex;
+				completions[i].timestamp = 0;
+			}
+
+			return (int)completionCount;
+		}
+
+		inline static void riosockets_backend_post(Rio* rio, int receiveBufferIndex) {
+			rio->functions.RIOReceiveEx(rio->requestQueue, &rio->receiveBuffers[receiveBufferIndex].data, 1, NULL, &rio->receiveBuffers[receiveBufferIndex].address, NULL, NULL, RIO_MSG_DEFER, (PVOID)(intptr_t)receiveBufferIndex);
+		}
+
+		inline static void riosockets_backend_commit(Rio* rio) {
+			rio->functions.RIOReceiveEx(rio->requestQueue, NULL, 0, NULL, NULL, NULL, NULL, RIO_MSG_COMMIT_ONLY, NULL);
+		}
+
+		static int riosockets_backend_wait(Rio* rio, int timeout) {
+			INT notifyResult = rio->functions.RIONotify(rio->receiveQueue);
+
+			if (notifyResult != ERROR_SUCCESS && notifyResult != WSAEALREADY)
+				return -1;
+
+			DWORD waitResult = WaitForSingleObject(rio->receiveEvent, (timeout < 0 ? INFINITE : (DWORD)timeout));
+
+			if (waitResult == WAIT_TIMEOUT)
+				return 0;
+
+			return waitResult == WAIT_OBJECT_0 ? 1 : -1;
+		}
+
+		RioStatus riosockets_initialize(void) {
+			WSADATA wsaData = { 0 };
+
+			if (WSAStartup(MAKEWORD(2, 2), &wsaData))
+				return RIOSOCKETS_STATUS_ERROR;
+
+			if (LOBYTE(wsaData.wVersion) != 2 || HIBYTE(wsaData.wVersion) != 2 || !IsWindows8OrGreater()) {
+				WSACleanup();
+
+				return RIOSOCKETS_STATUS_ERROR;
+			}
+
+			return RIOSOCKETS_STATUS_OK;
+		}
+
+		void riosockets_deinitialize(void) {
+			WSACleanup();
+		}
+	#endif // RIOSOCKETS_BACKEND_RIO
+
+	#ifndef RIOSOCKETS_BACKEND_RIO
+		static size_t riosockets_huge_page_size(void) {
+			static size_t hugePageSize = 0;
+
+			if (hugePageSize == 0) {
+				char information[4096] = { 0 };
+				int descriptor = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+				ssize_t length = (descriptor >= 0 ? read(descriptor, information, sizeof(information) - 1) : -1);
+				const char* field = (length > 0 ? strstr(information, "Hugepagesize:") : NULL);
+				size_t size = (field != NULL ? (size_t)strtoul(field + strlen("Hugepagesize:"), NULL, 10) * 1024 : 0);
+
+				if (descriptor >= 0)
+					close(descriptor);
+
+				hugePageSize = (size > 0 ? size : RIOSOCKETS_HUGE_PAGE_SIZE);
+			}
+
+			return hugePageSize;
+		}
+
+		inline static size_t riosockets_buffer_length(int flags, uint64_t bufferLength, uint64_t bufferCount) {
+			return riosockets_round_up(bufferLength * bufferCount, (flags & RIOSOCKETS_FLAG_HUGE_PAGES) ? riosockets_huge_page_size() : (size_t)sysconf(_SC_PAGESIZE));
+		}
+
+		static char* riosockets_buffer_allocate(int flags, int numaNode, uint64_t bufferLength, uint64_t bufferCount) {
+			size_t length = riosockets_buffer_length(flags, bufferLength, bufferCount);
+			void* buffer = NULL;
+
+			if (flags & RIOSOCKETS_FLAG_HUGE_PAGES) {
+				buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+				if (buffer == MAP_FAILED) {
+					buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+					if (buffer != MAP_FAILED)
+						madvise(buffer, length, MADV_HUGEPAGE);
+				}
+			} else if (numaNode < 0) {
+				buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+				return buffer == MAP_FAILED ? NULL : (char*)buffer;
+			} else {
+				buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			}
+
+			if (buffer == MAP_FAILED)
+				return NULL;
+
+			if (numaNode >= 0 && numaNode < RIOSOCKETS_MAX_NUMA_NODES) {
+				unsigned long nodeMask[RIOSOCKETS_MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+
+				nodeMask[numaNode / (8 * sizeof(unsigned long))] = 1UL << (numaNode % (8 * sizeof(unsigned long)));
+
+				syscall(SYS_mbind, buffer, length, RIOSOCKETS_MPOL_PREFERRED, nodeMask, RIOSOCKETS_MAX_NUMA_NODES + 1, 0);
+			}
+
+			memset(buffer, 0, length);
+
+			return (char*)buffer;
+		}
+
+		static void riosockets_buffer_free(int flags, char* buffer, uint64_t bufferLength, uint64_t bufferCount) {
+			if (buffer != NULL)
+				munmap(buffer, riosockets_buffer_length(flags, bufferLength, bufferCount));
+		}
+
+		inline static int riosockets_backend_register(RioArena* pool, RioError* error) {
+			(void)pool;
+			(void)error;
+
+			return 0;
+		}
+
+		RioStatus riosockets_initialize(void) {
+			return RIOSOCKETS_STATUS_OK;
+		}
+
+		void riosockets_deinitialize(void) { }
+	#endif
+
+	#ifdef RIOSOCKETS_BACKEND_IO_URING
+		// io_uring
+
+		inline static int riosockets_ring_enter(const RioRing* ring, unsigned submitCount, unsigned minCompletions, unsigned flags) {
+			return (int)syscall(__NR_io_uring_enter, ring->descriptor, submitCount, minCompletions, flags, NULL, 0);
+		}
+
+		inline static int riosockets_ring_register(const RioRing* ring, unsigned opcode, const void* argument, unsigned argumentCount) {
+			return (int)syscall(__NR_io_uring_register, ring->descriptor, opcode, argument, argumentCount);
+		}
+
+		static int riosockets_ring_create(RioRing* ring, unsigned entries, unsigned completionEntries, unsigned flags) {
+			struct io_uring_params parameters = { 0 };
+
+			parameters.flags = flags | IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+			parameters.cq_entries = completionEntries;
+			parameters.sq_thread_idle = RIOSOCKETS_SQPOLL_IDLE;
+
+			ring->descriptor = (int)syscall(__NR_io_uring_setup, entries, &parameters);
+
+			if (ring->descriptor < 0)
+				return -1;
+
+			if (!(parameters.features & IORING_FEAT_SINGLE_MMAP)) {
+				close(ring->descriptor);
+
+				ring->descriptor = -1;
+
+				return -1;
+			}
+
+			size_t submissionSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+			size_t completionSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+
+			ring->flags = parameters.flags;
+			ring->ringSize = submissionSize > completionSize ? submissionSize : completionSize;
+			ring->sqesSize = parameters.sq_entries * sizeof(struct io_uring_sqe);
+			ring->ring = mmap(NULL, ring->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->descriptor, IORING_OFF_SQ_RING);
+			ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->descriptor, IORING_OFF_SQES);
+
+			if (ring->ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+				return -1;
+
+			char* memory = (char*)ring->ring;
+			unsigned* array = (unsigned*)(memory + parameters.sq_off.array);
+
+			ring->sqHead = (unsigned*)(memory + parameters.sq_off.head);
+			ring->sqTail = (unsigned*)(memory + parameters.sq_off.tail);
+			ring->sqFlags = (unsigned*)(memory + parameters.sq_off.flags);
+			ring->sqMask = *(unsigned*)(memory + parameters.sq_off.ring_mask);
+			ring->sqEntries = parameters.sq_entries;
+			ring->sqLocalTail = *ring->sqTail;
+			ring->sqSubmitted = ring->sqLocalTail;
+			ring->cqHead = (unsigned*)(memory + parameters.cq_off.head);
+			ring->cqTail = (unsigned*)(memory + parameters.cq_off.tail);
+			ring->cqMask = *(unsigned*)(memory + parameters.cq_off.ring_mask);
+			ring->cqes = (struct io_uring_cqe*)(memory + parameters.cq_off.cqes);
+
+			for (unsigned i = 0; i < parameters.sq_entries; i++) {
+				array[i] = i;
+			}
+
+			return 0;
+		}
+
+		static void riosockets_ring_destroy(RioRing* ring) {
+			if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+				munmap(ring->sqes, ring->sqesSize);
+
+			if (ring->ring != NULL && ring->ring != MAP_FAILED)
+				munmap(ring->ring, ring->ringSize);
+
+			if (ring->descriptor >= 0)
+				close(ring->descriptor);
+		}
+
+		inline static struct io_uring_sqe* riosockets_ring_get(RioRing* ring) {
+			if (ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries)
+				return NULL;
+
+			struct io_uring_sqe* sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+
+			++ring->sqLocalTail;
+
+			memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+			return sqe;
+		}
+
+		static void riosockets_ring_submit(RioRing* ring) {
+			unsigned submitCount = ring->sqLocalTail - ring->sqSubmitted;
+
+			if (submitCount == 0)
+				return;
+
+			ring->sqSubmitted = ring->sqLocalTail;
+
+			__atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+			if (ring->flags & IORING_SETUP_SQPOLL) {
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+				if (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+					riosockets_ring_enter(ring, 0, 0, IORING_ENTER_SQ_WAKEUP);
+			} else {
+				riosockets_ring_enter(ring, submitCount, 0, 0);
+			}
+		}
+
+		inline static unsigned riosockets_ring_ready(RioRing* ring) {
+			unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+			if (tail == *ring->cqHead && (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) {
+				riosockets_ring_enter(ring, 0, 0, IORING_ENTER_GETEVENTS);
+
+				tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+			}
+
+			return tail;
+		}
+
+		inline static SOCKET riosockets_backend_socket(void) {
+			return socket(PF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		}
+
+		inline static int riosockets_backend_receive_length(const Rio* rio) {
+			return (int)riosockets_round_up(RIOSOCKETS_RECEIVE_HEADER_LENGTH + riosockets_receive_control_length(rio) + riosockets_receive_capacity(rio), 64);
+		}
+
+		static void riosockets_receive_arm(Rio* rio) {
+			struct io_uring_sqe* sqe = riosockets_ring_get(&rio->receiveQueue);
+
+			if (sqe == NULL)
+				return;
+
+			sqe->opcode = IORING_OP_RECVMSG;
+			sqe->fd = rio->socket;
+			sqe->addr = (uint64_t)(uintptr_t)&rio->receiveMessage;
+			sqe->len = 1;
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = 0;
+			sqe->user_data = RIOSOCKETS_RECEIVE_USER_DATA;
+
+			riosockets_ring_submit(&rio->receiveQueue);
+
+			rio->receiveArmed = TRUE;
+		}
+
+		static BOOL riosockets_send_probe(Rio* rio) {
+			struct io_uring_sqe* sqe = riosockets_ring_get(&rio->sendQueue);
+
+			if (sqe == NULL)
+				return FALSE;
+
+			// Registered buffers for plain sends depend on the kernel, an addressless send passes preparation and fails at issue if supported
+
+			sqe->opcode = IORING_OP_SEND;
+			sqe->fd = rio->socket;
+			sqe->addr = (uint64_t)(uintptr_t)rio->sendMemory;
+			sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+			sqe->buf_index = 0;
+			sqe->user_data = 0;
+
+			riosockets_ring_submit(&rio->sendQueue);
+
+			if (riosockets_ring_enter(&rio->sendQueue, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+				return FALSE;
+
+			unsigned head = *rio->sendQueue.cqHead;
+
+			if (head == riosockets_ring_ready(&rio->sendQueue))
+				return FALSE;
+
+			int result = rio->sendQueue.cqes[head & rio->sendQueue.cqMask].res;
+
+			__atomic_store_n(rio->sendQueue.cqHead, head + 1, __ATOMIC_RELEASE);
+
+			return result != -EINVAL;
+		}
+
+		static BOOL riosockets_send_probe_zerocopy(const Rio* rio) {
+			struct io_uring_probe* probe = (struct io_uring_probe*)calloc(1, sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+			BOOL supported = FALSE;
+
+			if (riosockets_ring_register(&rio->sendQueue, IORING_REGISTER_PROBE, probe, 256) == 0 && probe->last_op >= IORING_OP_SEND_ZC)
+				supported = (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED) != 0;
+
+			free(probe);
+
+			return supported;
+		}
+
+		static int riosockets_backend_create(Rio* rio, RioError* error) {
+			if (rio->sendBufferCount > RIOSOCKETS_RING_MAX_ENTRIES)
+				rio->sendBufferCount = RIOSOCKETS_RING_MAX_ENTRIES;
+
+			if (rio->receiveBufferCount > RIOSOCKETS_RING_MAX_ENTRIES)
+				rio->receiveBufferCount = RIOSOCKETS_RING_MAX_ENTRIES;
+
+			int sendQueueCreated = -1;
+
+			#ifdef RIOSOCKETS_SQPOLL
+				sendQueueCreated = riosockets_ring_create(&rio->sendQueue, rio->sendBufferCount, rio->sendBufferCount, IORING_SETUP_SQPOLL);
+
+				if (sendQueueCreated != 0) {
+					riosockets_ring_destroy(&rio->sendQueue);
+
+					memset(&rio->sendQueue, 0, sizeof(RioRing));
+
+					rio->sendQueue.descriptor = -1;
+				}
+			#endif
+
+			if (sendQueueCreated != 0 && riosockets_ring_create(&rio->sendQueue, rio->sendBufferCount, rio->sendBufferCount, 0) != 0) {
+				*error = (rio->sendQueue.descriptor < 0 && errno == ENOSYS) ? RIOSOCKETS_ERROR_RIO_EXTENSION : RIOSOCKETS_ERROR_RIO_COMPLETION_QUEUE;
+
+				return -1;
+			}
+
+			if (riosockets_ring_create(&rio->receiveQueue, 8, rio->receiveBufferCount, 0) != 0) {
+				*error = RIOSOCKETS_ERROR_RIO_COMPLETION_QUEUE;
+
+				return -1;
+			}
+
+			if (rio->pool != NULL) {
+				rio->sendMemory = rio->pool->memory;
+				rio->receiveMemory = rio->pool->memory;
+			} else {
+				rio->sendMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, rio->sendMemoryLength, 1);
+				rio->receiveMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, rio->receiveBufferLength, rio->receiveBufferCount);
+			}
+
+			unsigned receiveBufferRingEntries = 1;
+
+			while (receiveBufferRingEntries < (unsigned)rio->receiveBufferCount) {
+				receiveBufferRingEntries <<= 1;
+			}
+
+			rio->receiveBufferRing = (struct io_uring_buf_ring*)riosockets_buffer_allocate(rio->flags, rio->numaNode, sizeof(struct io_uring_buf), receiveBufferRingEntries);
+			rio->receiveBufferRingMask = receiveBufferRingEntries - 1;
+
+			if (rio->sendMemory == NULL || rio->receiveMemory == NULL || rio->receiveBufferRing == NULL) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+
+				return -1;
+			}
+
+			struct iovec sendRegion = { rio->sendMemory, (size_t)rio->sendMemoryLength };
+			struct io_uring_buf_reg receiveBufferRing = { 0 };
+
+			receiveBufferRing.ring_addr = (uint64_t)(uintptr_t)rio->receiveBufferRing;
+			receiveBufferRing.ring_entries = receiveBufferRingEntries;
+			receiveBufferRing.bgid = 0;
+
+			// Only sends use fixed buffers, receives land in the provided buffer ring. Pooled sockets share one arena, registering it with every ring would pin it once per socket
+
+			if ((rio->pool == NULL && riosockets_ring_register(&rio->sendQueue, IORING_REGISTER_BUFFERS, &sendRegion, 1) != 0) || riosockets_ring_register(&rio->receiveQueue, IORING_REGISTER_PBUF_RING, &receiveBufferRing, 1) != 0) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_REGISTRATION;
+
+				return -1;
+			}
+
+			rio->sendBuffers = (RioBuffer*)calloc(rio->sendBufferCount, sizeof(RioBuffer));
+			rio->receiveBuffers = (RioBuffer*)calloc(rio->receiveBufferCount, sizeof(RioBuffer));
+
+			rio->sendFixed = (rio->pool == NULL && riosockets_send_probe(rio));
+
+			if ((rio->flags & RIOSOCKETS_FLAG_ZEROCOPY) && !riosockets_send_probe_zerocopy(rio))
+				rio->flags &= ~RIOSOCKETS_FLAG_ZEROCOPY;
+
+			if ((rio->flags & RIOSOCKETS_FLAG_GSO) || rio->segmentCount > 0)
+				rio->sendMessages = (struct msghdr*)calloc(rio->sendBufferCount, sizeof(struct msghdr));
+
+			if (rio->flags & RIOSOCKETS_FLAG_GSO) {
+				rio->sendVectors = (struct iovec*)calloc(rio->sendBufferCount, sizeof(struct iovec));
+				rio->sendControls = (char*)calloc(rio->sendBufferCount, RIOSOCKETS_SEGMENT_CONTROL_LENGTH);
+			}
+
+			if (rio->segmentCount > 0)
+				rio->sendGatherVectors = (struct iovec*)calloc((size_t)rio->sendBufferCount * (RIOSOCKETS_MAX_GATHER_SEGMENTS + 1), sizeof(struct iovec));
+
+			for (int i = 0; i < rio->receiveBufferCount; ++i) {
+				struct io_uring_buf* buffer = &rio->receiveBufferRing->bufs[i];
+
+				rio->receiveBuffers[i].data.Offset = rio->receiveBufferLength * i;
+				rio->receiveBuffers[i].data.Length = rio->receiveBufferLength;
+
+				buffer->addr = (uint64_t)(uintptr_t)(rio->receiveMemory + rio->receiveBuffers[i].data.Offset);
+				buffer->len = rio->receiveBufferLength;
+				buffer->bid = (uint16_t)i;
+			}
+
+			rio->receiveMessage.msg_namelen = RIOSOCKETS_RECEIVE_NAME_LENGTH;
+			rio->receiveMessage.msg_controllen = riosockets_receive_control_length(rio);
+
+			if (rio->pool != NULL) {
+				rio->receiveBufferHeld = rio->receiveBufferCount;
+
+				return 0;
+			}
+
+			rio->receiveBufferRingTail = (unsigned short)rio->receiveBufferCount;
+
+			__atomic_store_n(&rio->receiveBufferRing->tail, rio->receiveBufferRingTail, __ATOMIC_RELEASE);
+
+			riosockets_receive_arm(rio);
+
+			if (rio->receiveArmed == FALSE) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_ASSOCIATION;
+
+				return -1;
+			}
+
+			return 0;
+		}
+
+		static void riosockets_backend_destroy(Rio* rio) {
+			riosockets_ring_destroy(&rio->sendQueue);
+			riosockets_ring_destroy(&rio->receiveQueue);
+
+			closesocket(rio->socket);
+
+			unsigned receiveBufferRingEntries = rio->receiveBufferRingMask + 1;
+
+			if (rio->pool == NULL) {
+				riosockets_buffer_free(rio->flags, rio->sendMemory, rio->sendMemoryLength, 1);
+				riosockets_buffer_free(rio->flags, rio->receiveMemory, rio->receiveBufferLength, rio->receiveBufferCount);
+			}
+
+			riosockets_buffer_free(rio->flags, (char*)rio->receiveBufferRing, sizeof(struct io_uring_buf), receiveBufferRingEntries);
+
+			free(rio->sendMessages);
+			free(rio->sendVectors);
+			free(rio->sendGatherVectors);
+			free(rio->sendControls);
+		}
+
+		static void riosockets_send_prepare(Rio* rio, struct io_uring_sqe* sqe, int sendBufferIndex) {
+			RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+
+			if (buffer->gatherCount != 0) {
+				struct msghdr* message = &rio->sendMessages[sendBufferIndex];
+				struct iovec* vectors = &rio->sendGatherVectors[(size_t)sendBufferIndex * (RIOSOCKETS_MAX_GATHER_SEGMENTS + 1)];
+
+				message->msg_name = (buffer->addressless == FALSE ? rio->sendMemory + buffer->address.Offset : NULL);
+				message->msg_namelen = (buffer->addressless == FALSE ? sizeof(struct sockaddr_in6) : 0);
+				message->msg_iov = vectors;
+				message->msg_iovlen = riosockets_send_gather(rio, buffer, vectors);
+				message->msg_control = NULL;
+				message->msg_controllen = 0;
+
+				sqe->opcode = IORING_OP_SENDMSG;
+				sqe->fd = rio->socket;
+				sqe->addr = (uint64_t)(uintptr_t)message;
+				sqe->len = 1;
+			} else {
+				sqe->opcode = IORING_OP_SEND;
+				sqe->fd = rio->socket;
+
+				if (riosockets_send_zerocopy(rio, buffer)) {
+					sqe->opcode = IORING_OP_SEND_ZC;
+
+					RIOSOCKETS_STATS_ADD(rio, zeroCopyMessages, 1);
+				}
+
+				sqe->addr = (uint64_t)(uintptr_t)(rio->sendMemory + buffer->data.Offset);
+				sqe->len = buffer->data.Length;
+
+				if (rio->sendFixed) {
+					sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+					sqe->buf_index = 0;
+				}
+
+				if (buffer->addressless == FALSE) {
+					sqe->addr2 = (uint64_t)(uintptr_t)(rio->sendMemory + buffer->address.Offset);
+					sqe->addr_len = sizeof(struct sockaddr_in6);
+				}
+			}
+		}
+
+		static void riosockets_backend_send(Rio* rio) {
+			while (rio->sendBufferQueue != 0) {
+				struct io_uring_sqe* sqe = riosockets_ring_get(&rio->sendQueue);
+
+				if (sqe == NULL)
+					break;
+
+				int sendBufferHead = riosockets_send_head(rio);
+				int segmentCount = riosockets_send_run(rio, sendBufferHead, rio->sendBufferQueue);
+				RioBuffer* buffer = &rio->sendBuffers[sendBufferHead];
+
+				if (segmentCount > 1) {
+					struct msghdr* message = &rio->sendMessages[sendBufferHead];
+					struct iovec* vectors = &rio->sendVectors[sendBufferHead];
+
+					for (int i = 0; i < segmentCount; i++) {
+						vectors[i].iov_base = rio->sendMemory + buffer[i].data.Offset;
+						vectors[i].iov_len = buffer[i].data.Length;
+					}
+
+					message->msg_name = (buffer->addressless == FALSE ? rio->sendMemory + buffer->address.Offset : NULL);
+					message->msg_namelen = (buffer->addressless == FALSE ? sizeof(struct sockaddr_in6) : 0);
+					message->msg_iov = vectors;
+					message->msg_iovlen = segmentCount;
+
+					riosockets_send_segment(message, rio->sendControls + (size_t)sendBufferHead * RIOSOCKETS_SEGMENT_CONTROL_LENGTH, buffer->data.Length);
+
+					sqe->opcode = IORING_OP_SENDMSG;
+					sqe->fd = rio->socket;
+					sqe->addr = (uint64_t)(uintptr_t)message;
+					sqe->len = 1;
+
+					RIOSOCKETS_STATS_ADD(rio, coalescedBatches, 1);
+					RIOSOCKETS_STATS_ADD(rio, coalescedMessages, segmentCount);
+				} else {
+					riosockets_send_prepare(rio, sqe, sendBufferHead);
+				}
+				sqe->user_data = (uint64_t)sendBufferHead | ((uint64_t)segmentCount << 32);
+
+				rio->sendBufferQueue -= segmentCount;
+				rio->sendBufferPending += segmentCount;
+			}
+
+			riosockets_ring_submit(&rio->sendQueue);
+		}
+
+		static int riosockets_backend_release(Rio* rio, const int* sendBufferIndices, int sendBufferCount) {
+			int released = 0;
+
+			while (released < sendBufferCount) {
+				struct io_uring_sqe* sqe = riosockets_ring_get(&rio->sendQueue);
+
+				if (sqe == NULL)
+					break;
+
+				riosockets_send_prepare(rio, sqe, sendBufferIndices[released]);
+
+				sqe->user_data = (uint64_t)sendBufferIndices[released] | ((uint64_t)1 << 32);
+
+				++released;
+			}
+
+			riosockets_ring_submit(&rio->sendQueue);
+
+			return released;
+		}
+
+		static void riosockets_backend_complete(Rio* rio) {
+			RioRing* ring = &rio->sendQueue;
+			unsigned head = *ring->cqHead;
+			unsigned tail = riosockets_ring_ready(ring);
+
+			while (head != tail) {
+				struct io_uring_cqe* cqe = &ring->cqes[head & ring->cqMask];
+				int sendBufferIndex = (int)(uint32_t)cqe->user_data;
+				int segmentCount = (int)(cqe->user_data >> 32);
+
+				// Zero-copy sends post the result first and a notification once the kernel releases the memory
+
+				for (int i = 0; i < segmentCount && !(cqe->flags & IORING_CQE_F_NOTIF); i++) {
+					if (cqe->res < 0) {
+						riosockets_send_failure(rio, sendBufferIndex + i);
+					} else {
+						RIOSOCKETS_STATS_ADD(rio, sentMessages, 1);
+						RIOSOCKETS_STATS_ADD(rio, sentBytes, riosockets_send_length(rio, &rio->sendBuffers[sendBufferIndex + i]));
+					}
+				}
+
+				for (int i = 0; i < segmentCount && !(cqe->flags & IORING_CQE_F_MORE); i++) {
+					riosockets_send_complete(rio, sendBufferIndex + i);
+				}
+
+				++head;
+			}
+
+			__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+		}
+
+		inline static void riosockets_backend_post(Rio* rio, int receiveBufferIndex) {
+			struct io_uring_buf* buffer = &rio->receiveBufferRing->bufs[rio->receiveBufferRingTail & rio->receiveBufferRingMask];
+
+			buffer->addr = (uint64_t)(uintptr_t)(rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].data.Offset);
+			buffer->len = rio->receiveBufferLength;
+			buffer->bid = (uint16_t)receiveBufferIndex;
+
+			++rio->receiveBufferRingTail;
+			--rio->receiveBufferHeld;
+		}
+
+		inline static void riosockets_backend_commit(Rio* rio) {
+			__atomic_store_n(&rio->receiveBufferRing->tail, rio->receiveBufferRingTail, __ATOMIC_RELEASE);
+
+			if (rio->receiveArmed == FALSE)
+				riosockets_receive_arm(rio);
+		}
+
+		static int riosockets_backend_receive(Rio* rio, RioCompletion* completions, int maxCompletions) {
+			RioRing* ring = &rio->receiveQueue;
+			unsigned head = *ring->cqHead;
+			unsigned tail = riosockets_ring_ready(ring);
+			int completionCount = 0;
+			BOOL exhausted = FALSE;
+
+			while (head != tail && completionCount < maxCompletions) {
+				struct io_uring_cqe* cqe = &ring->cqes[head & ring->cqMask];
+
+				++head;
+
+				if (!(cqe->flags & IORING_CQE_F_MORE)) {
+					rio->receiveArmed = FALSE;
+					exhausted = (cqe->res == -ENOBUFS);
+				}
+
+				if (cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER))
+					continue;
+
+				int receiveBufferIndex = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+				++rio->receiveBufferHeld;
+
+				struct io_uring_recvmsg_out* message = (struct io_uring_recvmsg_out*)(rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].data.Offset);
+				int dataOffset = (int)(RIOSOCKETS_RECEIVE_HEADER_LENGTH + rio->receiveMessage.msg_controllen);
+				int dataLength = cqe->res - dataOffset;
+
+				if (dataLength < 0) {
+					if (rio->pool != NULL)
+						riosockets_pool_release(rio, receiveBufferIndex);
+					else
+						riosockets_backend_post(rio, receiveBufferIndex);
+
+					continue;
+				}
+
+				completions[completionCount].data = (uint8_t*)message + dataOffset;
+				completions[completionCount].address = (const struct sockaddr_storage*)(message + 1);
+				completions[completionCount].dataLength = dataLength;
+				completions[completionCount].slot = receiveBufferIndex;
+
+				riosockets_receive_control(&completions[completionCount], (char*)(message + 1) + RIOSOCKETS_RECEIVE_NAME_LENGTH, message->controllen);
+
+				++completionCount;
+			}
+
+			__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+			if (rio->receiveArmed == FALSE && (exhausted == FALSE || rio->receiveBufferHeld < rio->receiveBufferCount))
+				riosockets_backend_commit(rio);
+
+			return completionCount;
+		}
+
+		inline static int riosockets_backend_descriptor(const Rio* rio) {
+			return rio->receiveQueue.descriptor;
+		}
+
+		inline static int riosockets_backend_send_descriptor(const Rio* rio) {
+			return rio->sendQueue.descriptor;
+		}
+
+		static int riosockets_backend_wait(Rio* rio, int timeout) {
+			struct __kernel_timespec time = { 0 };
+			struct io_uring_getevents_arg argument = { 0 };
+
+			time.tv_sec = timeout / 1000;
+			time.tv_nsec = (long long)(timeout % 1000) * 1000000;
+
+			argument.ts = (timeout < 0 ? 0 : (uint64_t)(uintptr_t)&time);
+
+			if (syscall(__NR_io_uring_enter, rio->receiveQueue.descriptor, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument)) < 0)
+				return (errno == ETIME || errno == EINTR) ? 0 : -1;
+
+			return 1;
+		}
+
+	#endif // RIOSOCKETS_BACKEND_IO_URING
+
+	#ifdef RIOSOCKETS_BACKEND_POSIX
+		// POSIX
+
+		inline static SOCKET riosockets_backend_socket(void) {
+			return socket(PF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		}
+
+		inline static int riosockets_backend_receive_length(const Rio* rio) {
+			return riosockets_receive_capacity(rio);
+		}
+
+		static int riosockets_backend_create(Rio* rio, RioError* error) {
+			if (rio->pool != NULL) {
+				rio->sendMemory = rio->pool->memory;
+				rio->receiveMemory = rio->pool->memory;
+			} else {
+				rio->sendMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, rio->sendMemoryLength, 1);
+				rio->receiveMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, riosockets_receive_region_length(rio), 1);
+			}
+
+			if (rio->sendMemory == NULL || rio->receiveMemory == NULL) {
+				*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+
+				return -1;
+			}
+
+			rio->sendBuffers = (RioBuffer*)calloc(rio->sendBufferCount, sizeof(RioBuffer));
+			rio->sendMessages = (struct mmsghdr*)calloc(RIOSOCKETS_MAX_BATCH_MESSAGES, sizeof(struct mmsghdr));
+			rio->sendVectors = (struct iovec*)calloc(RIOSOCKETS_MAX_BATCH_MESSAGES, sizeof(struct iovec));
+
+			if (rio->flags & RIOSOCKETS_FLAG_GSO)
+				rio->sendControls = (char*)calloc(RIOSOCKETS_MAX_BATCH_MESSAGES, RIOSOCKETS_SEGMENT_CONTROL_LENGTH);
+
+			// Notification identifiers are 32-bit counters of the kernel, a table of a power of two entries keeps mapping them to the same entries after they wrap
+
+			if (rio->flags & RIOSOCKETS_FLAG_ZEROCOPY) {
+				rio->zeroCopyMask = 1;
+
+				while (rio->zeroCopyMask < (uint32_t)rio->sendBufferCount) {
+					rio->zeroCopyMask <<= 1;
+				}
+
+				rio->zeroCopyIndices = (int*)calloc(rio->zeroCopyMask--, sizeof(int));
+			}
+
+			rio->receiveBuffers = (RioBuffer*)calloc(rio->receiveBufferCount, sizeof(RioBuffer));
+			rio->receiveMessages = (struct mmsghdr*)calloc(RIOSOCKETS_MAX_COMPLETION_RESULTS, sizeof(struct mmsghdr));
+			rio->receiveVectors = (struct iovec*)calloc(RIOSOCKETS_MAX_COMPLETION_RESULTS, sizeof(struct iovec));
+			rio->receiveSlots = (int*)calloc(rio->receiveBufferCount, sizeof(int));
+
+			if (riosockets_receive_control_length(rio) > 0)
+				rio->receiveControls = (char*)calloc(RIOSOCKETS_MAX_COMPLETION_RESULTS, riosockets_receive_control_length(rio));
+
+			for (int i = 0; i < rio->receiveBufferCount; ++i) {
+				RIO_BUF buffer = { 0 };
+
+				buffer.Offset = rio->receiveBufferLength * i;
+				buffer.Length = rio->receiveBufferLength;
+
+				rio->receiveBuffers[i].data = buffer;
+
+				buffer.Offset = (uint32_t)riosockets_receive_address_offset(rio) + sizeof(SOCKADDR_INET) * i;
+				buffer.Length = sizeof(SOCKADDR_INET);
+
+				rio->receiveBuffers[i].address = buffer;
+				rio->receiveSlots[i] = i;
+			}
+
+			rio->receiveBufferAvailable = (rio->pool != NULL ? 0 : rio->receiveBufferCount);
+
+			return 0;
+		}
+
+		static void riosockets_backend_destroy(Rio* rio) {
+			closesocket(rio->socket);
+
+			if (rio->pool == NULL) {
+				riosockets_buffer_free(rio->flags, rio->sendMemory, rio->sendMemoryLength, 1);
+				riosockets_buffer_free(rio->flags, rio->receiveMemory, riosockets_receive_region_length(rio), 1);
+			}
+
+			free(rio->sendMessages);
+			free(rio->sendVectors);
+			free(rio->sendControls);
+			free(rio->receiveMessages);
+			free(rio->receiveVectors);
+			free(rio->receiveControls);
+			free(rio->receiveSlots);
+			free(rio->zeroCopyIndices);
+		}
+
+		static int riosockets_send_message(const Rio* rio, struct msghdr* message, struct iovec* vectors, const RioBuffer* buffer) {
+			message->msg_name = (buffer->addressless == FALSE ? rio->sendMemory + buffer->address.Offset : NULL);
+			message->msg_namelen = (buffer->addressless == FALSE ? sizeof(struct sockaddr_in6) : 0);
+			message->msg_iov = vectors;
+			message->msg_iovlen = 1;
+			message->msg_control = NULL;
+			message->msg_controllen = 0;
+
+			if (buffer->gatherCount != 0) {
+				message->msg_iovlen = riosockets_send_gather(rio, buffer, vectors);
+			} else {
+				vectors[0].iov_base = rio->sendMemory + buffer->data.Offset;
+				vectors[0].iov_len = buffer->data.Length;
+			}
+
+			return (int)message->msg_iovlen;
+		}
+
+		static void riosockets_send_finish(Rio* rio, int sendBufferIndex, BOOL zeroCopy, BOOL failed) {
+			if (failed == TRUE) {
+				riosockets_send_failure(rio, sendBufferIndex);
+			} else {
+				RIOSOCKETS_STATS_ADD(rio, sentMessages, 1);
+				RIOSOCKETS_STATS_ADD(rio, sentBytes, riosockets_send_length(rio, &rio->sendBuffers[sendBufferIndex]));
+			}
+
+			// Each zero-copy send takes the next notification identifier of the socket
+
+			if (zeroCopy && failed == FALSE) {
+				rio->zeroCopyIndices[rio->zeroCopyNext++ & rio->zeroCopyMask] = sendBufferIndex;
+
+				RIOSOCKETS_STATS_ADD(rio, zeroCopyMessages, 1);
+			} else {
+				riosockets_send_complete(rio, sendBufferIndex);
+			}
+		}
+
+		static void riosockets_backend_send(Rio* rio) {
+			while (rio->sendBufferQueue != 0) {
+				int sendBufferHead = riosockets_send_head(rio);
+				int sendBufferQueue = rio->sendBufferQueue;
+				int messageCount = 0;
+				int vectorCount = 0;
+				BOOL zeroCopy = riosockets_send_zerocopy(rio, &rio->sendBuffers[sendBufferHead]);
+
+				for (int sendBufferIndex = sendBufferHead; sendBufferQueue != 0 && messageCount < RIOSOCKETS_MAX_BATCH_MESSAGES; messageCount++) {
+					int segmentCount = riosockets_send_run(rio, sendBufferIndex, sendBufferQueue);
+					RioBuffer* buffer = &rio->sendBuffers[sendBufferIndex];
+
+					if (vectorCount + segmentCount + buffer->gatherCount > RIOSOCKETS_MAX_BATCH_MESSAGES || riosockets_send_zerocopy(rio, buffer) != zeroCopy)
+						break;
+
+					struct msghdr* message = &rio->sendMessages[messageCount].msg_hdr;
+
+					message->msg_name = (buffer->addressless == FALSE ? rio->sendMemory + buffer->address.Offset : NULL);
+					message->msg_namelen = (buffer->addressless == FALSE ? sizeof(struct sockaddr_in6) : 0);
+					message->msg_iov = &rio->sendVectors[vectorCount];
+					message->msg_iovlen = segmentCount;
+					message->msg_control = NULL;
+					message->msg_controllen = 0;
+
+					if (segmentCount > 1)
+						riosockets_send_segment(message, rio->sendControls + (size_t)messageCount * RIOSOCKETS_SEGMENT_CONTROL_LENGTH, buffer->data.Length);
+
+					if (buffer->gatherCount != 0) {
+						message->msg_iovlen = riosockets_send_gather(rio, buffer, &rio->sendVectors[vectorCount]);
+						vectorCount += (int)message->msg_iovlen;
+
+						if (++sendBufferIndex == rio->sendBufferCount)
+							sendBufferIndex = 0;
+
+						--sendBufferQueue;
+
+						continue;
+					}
+
+					for (int i = 0; i < segmentCount; i++) {
+						rio->sendVectors[vectorCount].iov_base = rio->sendMemory + rio->sendBuffers[sendBufferIndex].data.Offset;
+						rio->sendVectors[vectorCount].iov_len = rio->sendBuffers[sendBufferIndex].data.Length;
+
+						++vectorCount;
+
+						if (++sendBufferIndex == rio->sendBufferCount)
+							sendBufferIndex = 0;
+					}
+
+					sendBufferQueue -= segmentCount;
+				}
+
+				int sentCount = sendmmsg(rio->socket, rio->sendMessages, messageCount, (zeroCopy ? MSG_ZEROCOPY : 0));
+				BOOL failed = FALSE;
+
+				if (sentCount < 0) {
+					if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+						break;
+
+					sentCount = 1;
+					failed = TRUE;
+				}
+
+				for (int i = 0; i < sentCount; i++) {
+					int segmentCount = (rio->sendBuffers[sendBufferHead].gatherCount != 0 ? 1 : (int)rio->sendMessages[i].msg_hdr.msg_iovlen);
+
+					if (segmentCount > 1 && failed == FALSE) {
+						RIOSOCKETS_STATS_ADD(rio, coalescedBatches, 1);
+						RIOSOCKETS_STATS_ADD(rio, coalescedMessages, segmentCount);
+					}
+
+					for (int j = 0; j < segmentCount; j++) {
+						--rio->sendBufferQueue;
+						++rio->sendBufferPending;
+
+						riosockets_send_finish(rio, sendBufferHead, zeroCopy, failed);
+
+						if (++sendBufferHead == rio->sendBufferCount)
+							sendBufferHead = 0;
+					}
+				}
+			}
+		}
+
+		static int riosockets_backend_release(Rio* rio, const int* sendBufferIndices, int sendBufferCount) {
+			int released = 0;
+
+			while (released < sendBufferCount) {
+				int messageCount = 0;
+				int vectorCount = 0;
+				BOOL zeroCopy = riosockets_send_zerocopy(rio, &rio->sendBuffers[sendBufferIndices[released]]);
+
+				for (; released + messageCount < sendBufferCount && messageCount < RIOSOCKETS_MAX_BATCH_MESSAGES; messageCount++) {
+					const RioBuffer* buffer = &rio->sendBuffers[sendBufferIndices[released + messageCount]];
+
+					if (vectorCount + 1 + buffer->gatherCount > RIOSOCKETS_MAX_BATCH_MESSAGES || riosockets_send_zerocopy(rio, buffer) != zeroCopy)
+						break;
+
+					vectorCount += riosockets_send_message(rio, &rio->sendMessages[messageCount].msg_hdr, &rio->sendVectors[vectorCount], buffer);
+				}
+
+				int sentCount = sendmmsg(rio->socket, rio->sendMessages, messageCount, (zeroCopy ? MSG_ZEROCOPY : 0));
+				BOOL failed = FALSE;
+
+				if (sentCount < 0) {
+					if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+						break;
+
+					sentCount = 1;
+					failed = TRUE;
+				}
+
+				for (int i = 0; i < sentCount; i++) {
+					riosockets_send_finish(rio, sendBufferIndices[released++], zeroCopy, failed);
+				}
+			}
+
+			return released;
+		}
+
+		static void riosockets_backend_complete(Rio* rio) {
+			char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+
+			while ((rio->flags & RIOSOCKETS_FLAG_ZEROCOPY) && rio->sendBufferPending != 0) {
+				struct msghdr message = { 0 };
+
+				message.msg_control = control;
+				message.msg_controllen = sizeof(control);
+
+				if (recvmsg(rio->socket, &message, MSG_ERRQUEUE) < 0)
+					break;
+
+				for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) {
+					if (!(header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR) && !(header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR))
+						continue;
+
+					struct sock_extended_err notification;
+
+					memcpy(&notification, CMSG_DATA(header), sizeof(notification));
+
+					if (notification.ee_origin != SO_EE_ORIGIN_ZEROCOPY || notification.ee_errno != 0)
+						continue;
+
+					uint32_t notificationCount = notification.ee_data - notification.ee_info + 1;
+
+					if (notification.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+						RIOSOCKETS_STATS_ADD(rio, zeroCopyCopied, notificationCount);
+
+					for (uint32_t i = 0; i < notificationCount; i++) {
+						riosockets_send_complete(rio, rio->zeroCopyIndices[(notification.ee_info + i) & rio->zeroCopyMask]);
+					}
+				}
+			}
+		}
+
+		static int riosockets_backend_receive(Rio* rio, RioCompletion* completions, int maxCompletions) {
+			int messageCount = rio->receiveBufferAvailable < maxCompletions ? rio->receiveBufferAvailable : maxCompletions;
+
+			if (messageCount == 0)
+				return 0;
+
+			for (int i = 0, receiveSlot = rio->receiveBufferHead; i < messageCount; i++) {
+				int receiveBufferIndex = rio->receiveSlots[receiveSlot];
+				struct msghdr* message = &rio->receiveMessages[i].msg_hdr;
+
+				rio->receiveVectors[i].iov_base = rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].data.Offset;
+				rio->receiveVectors[i].iov_len = rio->receiveBufferLength;
+
+				message->msg_name = rio->receiveMemory + rio->receiveBuffers[receiveBufferIndex].address.Offset;
+				message->msg_namelen = sizeof(SOCKADDR_INET);
+				message->msg_iov = &rio->receiveVectors[i];
+				message->msg_iovlen = 1;
+				message->msg_control = (rio->receiveControls != NULL ? rio->receiveControls + (size_t)i * riosockets_receive_control_length(rio) : NULL);
+				message->msg_controllen = riosockets_receive_control_length(rio);
+
+				if (++receiveSlot == rio->receiveBufferCount)
+					receiveSlot = 0;
+			}
+
+			int completionCount = recvmmsg(rio->socket, rio->receiveMessages, messageCount, MSG_DONTWAIT, NULL);
+
+			if (completionCount < 1)
+				return 0;
+
+			for (int i = 0; i < completionCount; i++) {
+				int receiveBufferIndex = rio->receiveSlots[rio->receiveBufferHead];
+
+				completions[i].data = (uint8_t*)rio->receiveVectors[i].iov_base;
+				completions[i].address = (const struct sockaddr_storage*)rio->receiveMessages[i].msg_hdr.msg_name;
+				completions[i].dataLength = (int)rio->receiveMessages[i].msg_len;
+				completions[i].slot = receiveBufferIndex;
+
+				riosockets_receive_control(&completions[i], rio->receiveMessages[i].msg_hdr.msg_control, rio->receiveMessages[i].msg_hdr.msg_controllen);
+
+				if (++rio->receiveBufferHead == rio->receiveBufferCount)
+					rio->receiveBufferHead = 0;
+			}
+
+			rio->receiveBufferAvailable -= completionCount;
+
+			return completionCount;
+		}
+
+		inline static void riosockets_backend_post(Rio* rio, int receiveBufferIndex) {
+			int receiveSlot = rio->receiveBufferHead + rio->receiveBufferAvailable;
+
+			if (receiveSlot >= rio->receiveBufferCount)
+				receiveSlot -= rio->receiveBufferCount;
+
+			rio->receiveSlots[receiveSlot] = receiveBufferIndex;
+
+			++rio->receiveBufferAvailable;
+		}
+
+		inline static void riosockets_backend_commit(Rio* rio) {
+			(void)rio;
+		}
+
+		inline static int riosockets_backend_descriptor(const Rio* rio) {
+			return (int)rio->socket;
+		}
+
+		// Sends complete synchronously, zero-copy notifications raise an error condition on the socket itself
+
+		inline static int riosockets_backend_send_descriptor(const Rio* rio) {
+			(void)rio;
+
+			return -1;
+		}
+
+		static int riosockets_backend_wait(Rio* rio, int timeout) {
+			struct pollfd descriptor = { 0 };
+
+			descriptor.fd = rio->socket;
+			descriptor.events = POLLIN;
+
+			int result = poll(&descriptor, 1, timeout);
+
+			if (result < 0)
+				return errno == EINTR ? 0 : -1;
+
+			return result;
+		}
+	#endif // RIOSOCKETS_BACKEND_POSIX
+
+	inline static void riosockets_receive_release(Rio* rio, int slot) {
+		if (slot >= 0 && slot < rio->receiveBufferCount && rio->receiveReferences[slot] > 0 && --rio->receiveReferences[slot] == 0) {
+			--rio->receiveBufferUsed;
+
+			if (rio->pool != NULL)
+				riosockets_pool_release(rio, slot);
+			else
+				riosockets_backend_post(rio, slot);
+		}
+	}
+
+	static int riosockets_pool_replenish(Rio* rio) {
+		int postedCount = 0;
+
+		while (rio->receiveIdleCount > 0 && rio->receiveBufferCount - rio->receiveIdleCount - rio->receiveBufferUsed < rio->receiveTarget && riosockets_pool_receive(rio, rio->receiveIdle[rio->receiveIdleCount - 1])) {
+			riosockets_backend_post(rio, rio->receiveIdle[--rio->receiveIdleCount]);
+
+			++postedCount;
+		}
+
+		return postedCount;
+	}
+
+	static void riosockets_pool_clear(Rio* rio) {
+		for (int i = 0; i < rio->receiveIdleCount; i++) {
+			rio->receiveReferences[rio->receiveIdle[i]] = -1;
+		}
+
+		for (int i = 0; i < rio->receiveBufferCount; i++) {
+			if (rio->receiveReferences[i] >= 0)
+				riosockets_pool_return(rio, rio->receiveBuffers[i].data.Offset);
+		}
+
+		for (int i = 0, sendBufferIndex = riosockets_send_oldest(rio); i < rio->sendBufferPending + rio->sendBufferQueue; i++) {
+			if (rio->sendBuffers[sendBufferIndex].reservedLength != 0)
+				riosockets_pool_return(rio, rio->sendBuffers[sendBufferIndex].data.Offset);
+
+			if (++sendBufferIndex == rio->sendBufferCount)
+				sendBufferIndex = 0;
+		}
+	}
+
+	#ifndef _WIN32
+		inline static BOOL riosockets_shm_loopback(const RioAddress* address) {
+			return IN6_IS_ADDR_LOOPBACK(&address->ipv6) || (IN6_IS_ADDR_V4MAPPED(&address->ipv6) && ((const uint8_t*)&address->ipv4.ip)[0] == 127);
+		}
+
+		static size_t riosockets_shm_digits(char* path, size_t offset, size_t length, uint64_t value) {
+			char digits[20];
+			int digitCount = 0;
+
+			do {
+				digits[digitCount++] = (char)('0' + value % 10);
+				value /= 10;
+			} while (value != 0);
+
+			if (offset + digitCount >= length)
+				return length;
+
+			while (digitCount > 0) {
+				path[offset++] = digits[--digitCount];
+			}
+
+			path[offset] = '\0';
+
+			return offset;
+		}
+
+		// Ports are unique only within a network namespace, so the path carries the inode of the namespace, the suffix names a file that is not published yet
+
+		static void riosockets_shm_path(char* path, size_t length, uint16_t port, uint64_t suffix) {
+			struct stat status;
+			size_t offset = riosockets_string_copy(path, RIOSOCKETS_SHM_PATH, length);
+
+			offset = riosockets_shm_digits(path, offset, length, (stat("/proc/self/ns/net", &status) == 0 ? (uint64_t)status.st_ino : 0));
+
+			if (offset + 1 < length) {
+				path[offset++] = '-';
+				offset = riosockets_shm_digits(path, offset, length, port);
+			}
+
+			if (suffix != 0 && offset + 1 < length) {
+				path[offset++] = '.';
+				riosockets_shm_digits(path, offset, length, suffix);
+			}
+		}
+
+		// The layout is taken from the local values, the header of a segment is writable by every process that maps it
+
+		inline static uint8_t* riosockets_shm_lane_data(RioShmSegment* segment, int lane, uint64_t laneLength) {
+			return (uint8_t*)&segment->lanes[RIOSOCKETS_SHM_LANES] + (size_t)lane * laneLength;
+		}
+
+		inline static uint32_t riosockets_shm_record_length(uint32_t dataLength) {
+			return (uint32_t)riosockets_round_up(sizeof(RioShmRecord) + dataLength, RIOSOCKETS_SHM_ALIGNMENT);
+		}
+
+		inline static size_t riosockets_shm_segment_length(size_t laneLength) {
+			return offsetof(RioShmSegment, lanes) + sizeof(RioShmLane) * RIOSOCKETS_SHM_LANES + laneLength * RIOSOCKETS_SHM_LANES;
+		}
+
+		inline static BOOL riosockets_shm_same(int file, const char* path) {
+			struct stat fileStatus, pathStatus;
+
+			return fstat(file, &fileStatus) == 0 && stat(path, &pathStatus) == 0 && fileStatus.st_dev == pathStatus.st_dev && fileStatus.st_ino == pathStatus.st_ino;
+		}
+
+		// The owner holds an exclusive lock on the inbox for its lifetime, so a published file whose lock can be taken belongs to an exited process and is replaced, a locked one is left alone
+
+		static BOOL riosockets_shm_unlink_stale(const char* path) {
+			int file = open(path, O_RDWR | O_CLOEXEC);
+			BOOL stale = FALSE;
+
+			if (file < 0)
+				return errno == ENOENT;
+
+			if (flock(file, LOCK_EX | LOCK_NB) == 0 && riosockets_shm_same(file, path)) {
+				struct stat status;
+
+				if (fstat(file, &status) == 0 && (size_t)status.st_size >= sizeof(RioShmSegment)) {
+					void* memory = mmap(NULL, sizeof(RioShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+					if (memory != MAP_FAILED) {
+						__atomic_store_n(&((RioShmSegment*)memory)->closed, 1, __ATOMIC_RELEASE);
+						munmap(memory, sizeof(RioShmSegment));
+					}
+				}
+
+				stale = (unlink(path) == 0);
+			}
+
+			close(file);
+
+			return stale;
+		}
+
+		static void riosockets_shm_wake_address(struct sockaddr_un* address, uint16_t port) {
+			size_t offset;
+
+			memset(address, 0, sizeof(*address));
+
+			address->sun_family = AF_UNIX;
+
+			riosockets_shm_path(address->sun_path, sizeof(address->sun_path), port, 0);
+
+			offset = strlen(address->sun_path);
+
+			riosockets_string_copy(address->sun_path + offset, ".wake", sizeof(address->sun_path) - offset);
+		}
+
+		// The inbox is initialized under a private name and linked to the published one, a process only ever unlinks the file it owns or a stale one
+
+		static void riosockets_shm_inbox(Rio* rio) {
+			RioShm* shm = rio->shm;
+			RioAddress address = { 0 };
+			char path[96], temporaryPath[96];
+
+			if (shm->inbox != NULL || riosockets_address_get((RioSocket)rio, &address) != RIOSOCKETS_STATUS_OK || address.port == 0)
+				return;
+
+			size_t length = riosockets_shm_segment_length(shm->laneLength);
+
+			riosockets_shm_path(path, sizeof(path), address.port, 0);
+			riosockets_shm_path(temporaryPath, sizeof(temporaryPath), address.port, (uint64_t)getpid());
+			unlink(temporaryPath);
+
+			int file = open(temporaryPath, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+			void* memory = MAP_FAILED;
+			RioShmSegment* inbox = NULL;
+
+			if (file < 0)
+				return;
+
+			if (flock(file, LOCK_EX | LOCK_NB) == 0 && ftruncate(file, (off_t)length) == 0)
+				memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+			if (memory == MAP_FAILED)
+				goto destroy;
+
+			inbox = (RioShmSegment*)memory;
+			inbox->laneCount = RIOSOCKETS_SHM_LANES;
+			inbox->laneLength = shm->laneLength;
+
+			if (link(temporaryPath, path) != 0 && (errno != EEXIST || !riosockets_shm_unlink_stale(path) || link(temporaryPath, path) != 0)) {
+				munmap(memory, length);
+
+				goto destroy;
+			}
+
+			unlink(temporaryPath);
+
+			// Senders wake up the owner through a datagram socket next to the inbox, a send to an owner that is gone fails instead of raising a signal
+
+			struct sockaddr_un wakeAddress;
+
+			riosockets_shm_wake_address(&wakeAddress, address.port);
+			unlink(wakeAddress.sun_path);
+
+			shm->wakeFile = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+			if (shm->wakeFile < 0 || bind(shm->wakeFile, (struct sockaddr*)&wakeAddress, sizeof(wakeAddress)) != 0) {
+				if (shm->wakeFile >= 0)
+					close(shm->wakeFile);
+
+				unlink(path);
+				munmap(memory, length);
+				close(file);
+
+				return;
+			}
+
+			shm->inbox = inbox;
+			shm->inboxLength = length;
+			shm->inboxFile = file;
+			shm->port = address.port;
+
+			__atomic_store_n(&inbox->magic, RIOSOCKETS_SHM_MAGIC, __ATOMIC_RELEASE);
+
+			return;
+
+			destroy:
+
+			unlink(temporaryPath);
+			close(file);
+		}
+
+		static void riosockets_shm_detach(RioShmPeer* peer, BOOL release) {
+			if (release && peer->lane >= 0)
+				__atomic_store_n(&peer->segment->lanes[peer->lane].owner, 0, __ATOMIC_RELEASE);
+
+			munmap(peer->segment, peer->length);
+
+			if (peer->wakeFile >= 0)
+				close(peer->wakeFile);
+
+			peer->segment = NULL;
+			peer->wakeFile = -1;
+			peer->laneLength = 0;
+			peer->lane = -1;
+			peer->pendingMessages = 0;
+			peer->pendingBytes = 0;
+		}
+
+		// A lane is claimed with a compare-and-swap of its owner, lanes of exited processes are reclaimed when all of them are taken
+
+		static BOOL riosockets_shm_attach(Rio* rio, RioShmPeer* peer) {
+			uint64_t owner = ((uint64_t)getpid() << 32) | rio->shm->port;
+			struct stat status;
+			char path[96];
+			void* memory = MAP_FAILED;
+
+			riosockets_shm_path(path, sizeof(path), peer->port, 0);
+
+			int file = open(path, O_RDWR | O_CLOEXEC);
+
+			if (file < 0)
+				return FALSE;
+
+			// A shared lock that can be taken means the owner is gone
+
+			if (flock(file, LOCK_SH | LOCK_NB) == 0) {
+				close(file);
+
+				return FALSE;
+			}
+
+			if (fstat(file, &status) == 0 && (size_t)status.st_size >= sizeof(RioShmSegment))
+				memory = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+			close(file);
+
+			if (memory == MAP_FAILED)
+				return FALSE;
+
+			RioShmSegment* segment = (RioShmSegment*)memory;
+
+			peer->segment = segment;
+			peer->length = status.st_size;
+			peer->lane = -1;
+
+			if (__atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) == RIOSOCKETS_SHM_MAGIC)
+				peer->laneLength = segment->laneLength;
+
+			if (peer->laneLength == 0 || segment->closed || segment->laneCount != RIOSOCKETS_SHM_LANES || riosockets_shm_segment_length(peer->laneLength) != peer->length || riosockets_shm_record_length(rio->maxBufferLength) * 2 > peer->laneLength) {
+				riosockets_shm_detach(peer, FALSE);
+
+				return FALSE;
+			}
+
+			struct sockaddr_un wakeAddress;
+
+			riosockets_shm_wake_address(&wakeAddress, peer->port);
+
+			peer->wakeFile = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+			if (peer->wakeFile < 0 || connect(peer->wakeFile, (struct sockaddr*)&wakeAddress, sizeof(wakeAddress)) != 0) {
+				riosockets_shm_detach(peer, FALSE);
+
+				return FALSE;
+			}
+
+			for (int pass = 0; pass < 2 && peer->lane < 0; pass++) {
+				for (int i = 0; i < RIOSOCKETS_SHM_LANES; i++) {
+					uint64_t expected = __atomic_load_n(&segment->lanes[i].owner, __ATOMIC_ACQUIRE);
+
+					if (pass == 1 && (expected == 0 || kill((pid_t)(expected >> 32), 0) == 0 || errno != ESRCH))
+						continue;
+
+					if ((pass == 0 && expected != 0) || !RIOSOCKETS_ATOMIC_CAS(&segment->lanes[i].owner, expected, owner))
+						continue;
+
+					peer->lane = (int)i;
+
+					break;
+				}
+			}
+
+			if (peer->lane < 0) {
+				riosockets_shm_detach(peer, FALSE);
+
+				return FALSE;
+			}
+
+			peer->tail = __atomic_load_n(&segment->lanes[peer->lane].tail, __ATOMIC_ACQUIRE);
+
+			return TRUE;
+		}
+
+		// Returns a peer with a mapped segment, or NULL if the destination has no inbox and the message goes over UDP
+
+		static RioShmPeer* riosockets_shm_peer(Rio* rio, uint16_t port) {
+			RioShm* shm = rio->shm;
+			RioShmPeer* peer = NULL;
+
+			if (shm->peerLast < shm->peerCount && shm->peers[shm->peerLast].port == port) {
+				peer = &shm->peers[shm->peerLast];
+			} else {
+				for (int i = 0; i < shm->peerCount; i++) {
+					if (shm->peers[i].port == port) {
+						peer = &shm->peers[i];
+						shm->peerLast = i;
+
+						break;
+					}
+				}
+			}
+
+			if (peer == NULL) {
+				if (shm->peerCount == RIOSOCKETS_SHM_PEERS)
+					return NULL;
+
+				shm->peerLast = shm->peerCount++;
+				peer = &shm->peers[shm->peerLast];
+				peer->port = port;
+				peer->wakeFile = -1;
+				peer->lane = -1;
+			}
+
+			if (peer->segment != NULL && __atomic_load_n(&peer->segment->closed, __ATOMIC_ACQUIRE))
+				riosockets_shm_detach(peer, FALSE);
+
+			if (peer->segment == NULL) {
+				uint64_t time = riosockets_clock();
+
+				if (time < peer->retry)
+					return NULL;
+
+				riosockets_shm_inbox(rio);
+
+				if (shm->inbox == NULL) {
+					riosockets_bind((RioSocket)rio, NULL);
+					riosockets_shm_inbox(rio);
+				}
+
+				if (shm->inbox == NULL || !riosockets_shm_attach(rio, peer)) {
+					peer->retry = time + RIOSOCKETS_SHM_RETRY;
+
+					return NULL;
+				}
+			}
+
+			return peer;
+		}
+
+		// Writes the record header into the lane of the destination and returns its payload, the record is published with the next send
+
+		static uint8_t* riosockets_shm_buffer(Rio* rio, RioShmPeer* peer, int dataLength) {
+			RioShmSegment* segment = peer->segment;
+			RioShmLane* lane = &segment->lanes[peer->lane];
+			uint64_t laneLength = peer->laneLength;
+			uint64_t offset = peer->tail % laneLength;
+			uint32_t recordLength = riosockets_shm_record_length(dataLength);
+			uint64_t padding = (offset + recordLength > laneLength ? laneLength - offset : 0);
+
+			if (peer->tail + padding + recordLength - __atomic_load_n(&lane->head, __ATOMIC_ACQUIRE) > laneLength) {
+				RIOSOCKETS_STATS_ADD(rio, sendRejections, 1);
+
+				return NULL;
+			}
+
+			uint8_t* data = riosockets_shm_lane_data(segment, peer->lane, laneLength);
+
+			if (padding != 0) {
+				((RioShmRecord*)(data + offset))->length = RIOSOCKETS_SHM_WRAP;
+
+				peer->tail += padding;
+				offset = 0;
+			}
+
+			RioShmRecord* record = (RioShmRecord*)(data + offset);
+
+			record->length = (uint32_t)dataLength;
+			record->port = rio->shm->port;
+			record->references = 0;
+
+			peer->tail += recordLength;
+			++peer->pendingMessages;
+			peer->pendingBytes += dataLength;
+
+			return (uint8_t*)(record + 1);
+		}
+
+		static uint8_t* riosockets_shm_route(Rio* rio, const RioAddress* address, int dataLength, BOOL* routed) {
+			RioShm* shm = rio->shm;
+
+			*routed = FALSE;
+
+			if (address == NULL ? !shm->remoteLoopback : !riosockets_shm_loopback(address))
+				return NULL;
+
+			RioShmPeer* peer = riosockets_shm_peer(rio, (address == NULL ? shm->remotePort : address->port));
+
+			if (peer == NULL)
+				return NULL;
+
+			*routed = TRUE;
+
+			if (dataLength < 0 || dataLength > rio->maxBufferLength)
+				return NULL;
+
+			return riosockets_shm_buffer(rio, peer, dataLength);
+		}
+
+		// Tails are published before the waiting flag is checked, a consumer that announced waiting after the fence sees them, one that announced it before gets a wake-up datagram
+
+		static void riosockets_shm_send(Rio* rio) {
+			RioShm* shm = rio->shm;
+			uint8_t signal = 1;
+
+			for (int i = 0; i < shm->peerCount; i++) {
+				RioShmPeer* peer = &shm->peers[i];
+
+				if (peer->pendingMessages == 0)
+					continue;
+
+				RioShmSegment* segment = peer->segment;
+
+				__atomic_store_n(&segment->lanes[peer->lane].tail, peer->tail, __ATOMIC_RELEASE);
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+				if (__atomic_load_n(&segment->waiting, __ATOMIC_RELAXED))
+					send(peer->wakeFile, &signal, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+				RIOSOCKETS_STATS_ADD(rio, sentMessages, peer->pendingMessages);
+				RIOSOCKETS_STATS_ADD(rio, sentBytes, peer->pendingBytes);
+
+				peer->pendingMessages = 0;
+				peer->pendingBytes = 0;
+			}
+		}
+
+		static BOOL riosockets_shm_pending(Rio* rio) {
+			RioShm* shm = rio->shm;
+
+			if (shm == NULL || shm->inbox == NULL)
+				return FALSE;
+
+			for (int i = 0; i < RIOSOCKETS_SHM_LANES; i++) {
+				if (__atomic_load_n(&shm->inbox->lanes[i].tail, __ATOMIC_ACQUIRE) != shm->reads[i])
+					return TRUE;
+			}
+
+			return FALSE;
+		}
+
+		// The header of a record is written by the sender, a record that doesn't fit between the offset and the end of the lane, or exceeds the maximum buffer length, is corrupt
+
+		inline static BOOL riosockets_shm_record_valid(Rio* rio, uint32_t length, uint64_t offset, uint64_t laneLength) {
+			if (length == RIOSOCKETS_SHM_WRAP)
+				return TRUE;
+
+			return length <= (uint32_t)rio->maxBufferLength && offset + riosockets_shm_record_length(length) <= laneLength;
+		}
+
+		// Skips the rest of a lane, the head follows if no record before it is still referenced
+
+		static void riosockets_shm_drop(Rio* rio, int lane, uint64_t tail) {
+			RioShmLane* inboxLane = &rio->shm->inbox->lanes[lane];
+
+			if (__atomic_load_n(&inboxLane->head, __ATOMIC_RELAXED) == rio->shm->reads[lane])
+				__atomic_store_n(&inboxLane->head, tail, __ATOMIC_RELEASE);
+
+			rio->shm->reads[lane] = tail;
+		}
+
+		// Lanes are served round-robin, one message at a time, so a busy sender can't starve the others, a lane with a corrupt record or tail is dropped
+
+		static BOOL riosockets_shm_receive(Rio* rio, RioMessage* message) {
+			RioShm* shm = rio->shm;
+
+			if (shm == NULL || shm->inbox == NULL)
+				return FALSE;
+
+			RioShmSegment* inbox = shm->inbox;
+			uint64_t laneLength = shm->laneLength;
+
+			for (int i = 0; i < RIOSOCKETS_SHM_LANES; i++) {
+				int lane = shm->laneNext;
+				uint64_t tail = __atomic_load_n(&inbox->lanes[lane].tail, __ATOMIC_ACQUIRE);
+				uint8_t* data = riosockets_shm_lane_data(inbox, lane, laneLength);
+
+				if (++shm->laneNext == RIOSOCKETS_SHM_LANES)
+					shm->laneNext = 0;
+
+				if (tail - shm->reads[lane] > laneLength) {
+					riosockets_shm_drop(rio, lane, tail);
+
+					continue;
+				}
+
+				while (shm->reads[lane] != tail) {
+					uint64_t offset = shm->reads[lane] % laneLength;
+					RioShmRecord* record = (RioShmRecord*)(data + offset);
+					uint32_t length = record->length;
+
+					if (!riosockets_shm_record_valid(rio, length, offset, laneLength)) {
+						riosockets_shm_drop(rio, lane, tail);
+
+						break;
+					}
+
+					if (length == RIOSOCKETS_SHM_WRAP) {
+						shm->reads[lane] += laneLength - offset;
+
+						continue;
+					}
+
+					record->references = 1;
+					shm->reads[lane] += riosockets_shm_record_length(length);
+
+					memset(&message->address, 0, sizeof(message->address));
+
+					message->data = (const uint8_t*)(record + 1);
+					message->dataLength = (int)length;
+					message->slot = RIOSOCKETS_SHM_SLOT | (lane << 22) | (int)(offset / RIOSOCKETS_SHM_ALIGNMENT);
+					message->address.ipv6 = in6addr_loopback;
+					message->address.port = record->port;
+					message->timestamp = 0;
+					message->dequeueTimestamp = 0;
+					message->peer = -1;
+
+					if (rio->peerTable != NULL) {
+						struct sockaddr_in6 socketAddress;
+
+						riosockets_address_encode(&socketAddress, &message->address);
+
+						message->peer = riosockets_peer_lookup(rio, &socketAddress);
+					}
+
+					RIOSOCKETS_STATS_ADD(rio, receivedMessages, 1);
+					RIOSOCKETS_STATS_ADD(rio, receivedBytes, length);
+
+					return TRUE;
+				}
+			}
+
+			return FALSE;
+		}
+
+		inline static RioShmRecord* riosockets_shm_record(Rio* rio, int slot) {
+			RioShmSegment* inbox = rio->shm->inbox;
+			int lane = (slot & (RIOSOCKETS_SHM_SLOT - 1)) >> 22;
+			uint64_t offset = (uint64_t)(slot & ((1 << 22) - 1)) * RIOSOCKETS_SHM_ALIGNMENT;
+
+			if (lane >= RIOSOCKETS_SHM_LANES || offset + sizeof(RioShmRecord) > (uint64_t)rio->shm->laneLength)
+				return NULL;
+
+			return (RioShmRecord*)(riosockets_shm_lane_data(inbox, lane, rio->shm->laneLength) + offset);
+		}
+
+		static void riosockets_shm_retain(Rio* rio, int slot) {
+			RioShmRecord* record = riosockets_shm_record(rio, slot);
+
+			if (record != NULL && record->references > 0)
+				++record->references;
+		}
+
+		// The head of a lane moves over released records in order, a retained record holds back the ones after it
+
+		static void riosockets_shm_release(Rio* rio, int slot) {
+			RioShmRecord* record = riosockets_shm_record(rio, slot);
+
+			if (record == NULL || record->references <= 0 || --record->references > 0)
+				return;
+
+			RioShmSegment* inbox = rio->shm->inbox;
+			int lane = (slot & (RIOSOCKETS_SHM_SLOT - 1)) >> 22;
+			uint64_t laneLength = rio->shm->laneLength;
+			uint8_t* data = riosockets_shm_lane_data(inbox, lane, laneLength);
+			uint64_t head = inbox->lanes[lane].head;
+			uint64_t read = rio->shm->reads[lane];
+
+			while (head != read) {
+				uint64_t offset = head % laneLength;
+
+				record = (RioShmRecord*)(data + offset);
+
+				uint32_t length = record->length;
+
+				if (!riosockets_shm_record_valid(rio, length, offset, laneLength)) {
+					head = read;
+
+					break;
+				}
+
+				if (length == RIOSOCKETS_SHM_WRAP) {
+					head += laneLength - offset;
+
+					continue;
+				}
+
+				if (record->references > 0)
+					break;
+
+				head += riosockets_shm_record_length(length);
+			}
+
+			__atomic_store_n(&inbox->lanes[lane].head, head, __ATOMIC_RELEASE);
+		}
+
+		// The lanes are checked after waiting is announced, so a message published before isn't missed and one published after sends a wake-up
+
+		static BOOL riosockets_shm_announce(Rio* rio) {
+			__atomic_store_n(&rio->shm->inbox->waiting, 1, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+			return riosockets_shm_pending(rio);
+		}
+
+		static void riosockets_shm_settle(Rio* rio) {
+			uint8_t signals[64];
+
+			__atomic_store_n(&rio->shm->inbox->waiting, 0, __ATOMIC_RELAXED);
+
+			while (recv(rio->shm->wakeFile, signals, sizeof(signals), MSG_DONTWAIT) > 0) {
+				continue;
+			}
+		}
+
+		// Blocks on the socket and the wake-up socket of the inbox at once
+
+		static int riosockets_shm_wait(Rio* rio, int timeout) {
+			struct pollfd descriptors[2] = { { 0 } };
+			int result = 1;
+
+			descriptors[0].fd = riosockets_backend_descriptor(rio);
+			descriptors[0].events = POLLIN;
+			descriptors[1].fd = rio->shm->wakeFile;
+			descriptors[1].events = POLLIN;
+
+			if (!riosockets_shm_announce(rio)) {
+				result = poll(descriptors, 2, timeout);
+
+				if (result < 0)
+					result = (errno == EINTR ? 0 : -1);
+			}
+
+			riosockets_shm_settle(rio);
+
+			return result;
+		}
+
+		static void riosockets_shm_destroy(Rio* rio) {
+			RioShm* shm = rio->shm;
+
+			for (int i = 0; i < shm->peerCount; i++) {
+				if (shm->peers[i].segment != NULL)
+					riosockets_shm_detach(&shm->peers[i], TRUE);
+			}
+
+			if (shm->inbox != NULL) {
+				char path[96];
+
+				__atomic_store_n(&shm->inbox->closed, 1, __ATOMIC_RELEASE);
+
+				riosockets_shm_path(path, sizeof(path), shm->port, 0);
+
+				if (riosockets_shm_same(shm->inboxFile, path)) {
+					struct sockaddr_un wakeAddress;
+
+					riosockets_shm_wake_address(&wakeAddress, shm->port);
+					unlink(wakeAddress.sun_path);
+					unlink(path);
+				}
+
+				munmap(shm->inbox, shm->inboxLength);
+				close(shm->wakeFile);
+				close(shm->inboxFile);
+			}
+
+			free(shm->reads);
+			free(shm->peers);
+			free(shm);
+		}
+	#else
+		inline static uint8_t* riosockets_shm_route(Rio* rio, const RioAddress* address, int dataLength, BOOL* routed) {
+			*routed = FALSE;
+
+			return NULL;
+		}
+
+		inline static void riosockets_shm_inbox(Rio* rio) { }
+
+		inline static void riosockets_shm_send(Rio* rio) { }
+
+		inline static BOOL riosockets_shm_pending(Rio* rio) {
+			return FALSE;
+		}
+
+		inline static BOOL riosockets_shm_receive(Rio* rio, RioMessage* message) {
+			return FALSE;
+		}
+
+		inline static void riosockets_shm_retain(Rio* rio, int slot) { }
+
+		inline static void riosockets_shm_release(Rio* rio, int slot) { }
+
+		inline static int riosockets_shm_wait(Rio* rio, int timeout) {
+			return riosockets_backend_wait(rio, timeout);
+		}
+
+		inline static void riosockets_shm_destroy(Rio* rio) { }
+	#endif
+
+	static BOOL riosockets_receive_fill(Rio* rio, int maxCompletions) {
+		if (rio->receiveCompletionIndex < rio->receiveCompletionCount)
+			return TRUE;
+
+		if (maxCompletions > RIOSOCKETS_MAX_COMPLETION_RESULTS)
+			maxCompletions = RIOSOCKETS_MAX_COMPLETION_RESULTS;
+
+		if (rio->pool != NULL && riosockets_pool_replenish(rio) > 0)
+			riosockets_backend_commit(rio);
+
+		rio->receiveCompletionIndex = 0;
+		rio->receiveCompletionOffset = 0;
+		rio->receiveBundleOffset = 0;
+		rio->receiveCompletionCount = riosockets_backend_receive(rio, rio->receiveCompletions, maxCompletions);
+
+		if (rio->receiveCompletionCount <= 0) {
+			rio->receiveCompletionCount = 0;
+
+			return FALSE;
+		}
+
+		// Taken once per batch in the clock of the kernel timestamps, so the difference is the time messages waited in the queues
+
+		if (rio->flags & RIOSOCKETS_FLAG_TIMESTAMP)
+			rio->receiveDequeueTimestamp = riosockets_realtime();
+
+		rio->receiveBufferUsed += rio->receiveCompletionCount;
+
+		if (rio->capture != NULL)
+			riosockets_capture_receive(rio);
+
+		if (rio->pool != NULL) {
+			if (rio->receiveCompletionCount >= rio->receiveTarget)
+				rio->receiveTarget = (rio->receiveTarget * 2 < rio->receiveBufferCount ? rio->receiveTarget * 2 : rio->receiveBufferCount);
+			else if (rio->receiveCompletionCount < rio->receiveTarget / 4 && rio->receiveTarget > RIOSOCKETS_POOL_RECEIVE_TARGET)
+				rio->receiveTarget /= 2;
+		}
+
+		RIOSOCKETS_STATS_ADD(rio, completionBatches[riosockets_stats_bucket(rio->receiveCompletionCount)], 1);
+		RIOSOCKETS_STATS_PEAK(rio, receiveHeldPeak, rio->receiveBufferUsed);
+
+		return TRUE;
+	}
+
+	inline static uint64_t riosockets_wait_budget(const Rio* rio) {
+		uint64_t spinLimit = (uint64_t)RIOSOCKETS_WAIT_SPIN_LIMIT * 1000;
+
+		if (rio->receiveInterval == 0 || rio->receiveInterval > spinLimit)
+			return 0;
+
+		return rio->receiveInterval * 2 < spinLimit ? rio->receiveInterval * 2 : spinLimit;
+	}
+
+	// Features in use by the socket, which a specialized loop can't leave out
+
+	inline static int riosockets_features(const Rio* rio) {
+		return (rio->peerTable != NULL ? RIOSOCKETS_FEATURE_PEERS : 0) | ((rio->flags & (RIOSOCKETS_FLAG_GSO | RIOSOCKETS_FLAG_GRO)) ? RIOSOCKETS_FEATURE_COALESCING : 0) | ((rio->flags & RIOSOCKETS_FLAG_BUNDLE) ? RIOSOCKETS_FEATURE_BUNDLE : 0) | ((rio->flags & RIOSOCKETS_FLAG_SHARED_MEMORY) ? RIOSOCKETS_FEATURE_SHARED_MEMORY : 0);
+	}
+
+	// Instantiated with a constant set of features by the specialized loops, the parts that are left out are removed by the compiler
+
+	RIOSOCKETS_INLINE BOOL riosockets_receive_message(Rio* rio, RioMessage* message, int maxCompletions, const int features) {
+		for (;;) {
+			if (!riosockets_receive_fill(rio, maxCompletions))
+				return FALSE;
+
+			RioCompletion* completion = &rio->receiveCompletions[rio->receiveCompletionIndex];
+			const uint8_t* data = (const uint8_t*)(completion->data + rio->receiveCompletionOffset);
+			int datagramLength = completion->dataLength - rio->receiveCompletionOffset;
+
+			if (rio->receiveCompletionOffset == 0 && rio->receiveBundleOffset == 0) {
+				++rio->receiveReferences[completion->slot];
+
+				completion->peer = ((features & RIOSOCKETS_FEATURE_PEERS) && rio->peerTable != NULL ? riosockets_peer_lookup(rio, (const struct sockaddr_in6*)completion->address) : -1);
+			}
+
+			if ((features & RIOSOCKETS_FEATURE_COALESCING) && completion->segmentLength > 0 && datagramLength > completion->segmentLength)
+				datagramLength = completion->segmentLength;
+
+			int dataLength = datagramLength;
+
+			// Bundled messages are sliced out of each datagram in place, the datagram is validated as a whole before the first one
+
+			if ((features & RIOSOCKETS_FEATURE_BUNDLE) && (rio->flags & RIOSOCKETS_FLAG_BUNDLE) && (rio->receiveBundleOffset != 0 || riosockets_bundle_valid(data, datagramLength))) {
+				int bundleOffset = (rio->receiveBundleOffset != 0 ? rio->receiveBundleOffset : RIOSOCKETS_BUNDLE_HEADER);
+
+				rio->receiveBundleOffset = bundleOffset;
+				dataLength = riosockets_bundle_next(data, datagramLength, &rio->receiveBundleOffset);
+				data += bundleOffset + RIOSOCKETS_BUNDLE_FRAME;
+
+				if ((features & RIOSOCKETS_FEATURE_STATS) && bundleOffset != RIOSOCKETS_BUNDLE_HEADER)
+					RIOSOCKETS_STATS_ADD(rio, bundledMessages, 1);
+
+				if (rio->receiveBundleOffset < datagramLength)
+					datagramLength = 0;
+				else
+					rio->receiveBundleOffset = 0;
+			}
+
+			if (dataLength >= 0) {
+				message->data = data;
+				message->dataLength = dataLength;
+				message->slot = completion->slot;
+				message->timestamp = completion->timestamp;
+				message->dequeueTimestamp = rio->receiveDequeueTimestamp;
+				message->peer = completion->peer;
+
+				if (features & RIOSOCKETS_FEATURE_STATS) {
+					RIOSOCKETS_STATS_ADD(rio, receivedMessages, 1);
+					RIOSOCKETS_STATS_ADD(rio, receivedBytes, dataLength);
+				}
+
+				riosockets_address_extract(&message->address, completion->address);
+
+				++rio->receiveReferences[completion->slot];
+			}
+
+			rio->receiveCompletionOffset += datagramLength;
+
+			if (rio->receiveCompletionOffset >= completion->dataLength && rio->receiveBundleOffset == 0) {
+				rio->receiveCompletionOffset = 0;
+				++rio->receiveCompletionIndex;
+
+				riosockets_receive_release(rio, completion->slot);
+			}
+
+			if (dataLength >= 0)
+				return TRUE;
+		}
+	}
+
+	// Shared memory and the socket take turns, so a busy source can't starve the other, a socket found empty isn't asked again within the same call
+
+	RIOSOCKETS_INLINE BOOL riosockets_receive_next(Rio* rio, RioMessage* message, int maxCompletions, BOOL* socketEmpty, const int features) {
+		if (!(features & RIOSOCKETS_FEATURE_SHARED_MEMORY) || rio->shm == NULL)
+			return riosockets_receive_message(rio, message, maxCompletions, features);
+
+		rio->shm->socketFirst = !rio->shm->socketFirst;
+
+		if (rio->shm->socketFirst || riosockets_shm_receive(rio, message) == FALSE) {
+			if (*socketEmpty == FALSE && riosockets_receive_message(rio, message, maxCompletions, features))
+				return TRUE;
+
+			*socketEmpty = TRUE;
+
+			return rio->shm->socketFirst && riosockets_shm_receive(rio, message);
+		}
+
+		return TRUE;
+	}
+
+	RioSocket riosockets_create(int maxBufferLength, int sendBufferSize, int receiveBufferSize, RioCallback callback, RioError* error) {
+		RioOptions options = { 0 };
+
+		options.maxBufferLength = maxBufferLength;
+		options.sendBufferSize = sendBufferSize;
+		options.receiveBufferSize = receiveBufferSize;
+		options.callback = callback;
+		options.flags = RIOSOCKETS_FLAG_NONE;
+
+		return riosockets_create_ex(&options, error);
+	}
+
+	RioSocket riosockets_create_ex(const RioOptions* options, RioError* error) {
+		Rio* rio = NULL;
+
+		if (options == NULL || error == NULL)
+			return -1;
+
+		if (options->callback == NULL || ((options->flags & RIOSOCKETS_FLAG_SHARED_MEMORY) && (options->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND))) {
+			*error = RIOSOCKETS_ERROR_OPTIONS;
+
+			return -1;
+		}
+
+		int maxBufferLength = options->maxBufferLength;
+		int sendBufferSize = options->sendBufferSize;
+		int receiveBufferSize = options->receiveBufferSize;
+
+		SOCKET socket = riosockets_backend_socket();
+
+		if (socket != INVALID_SOCKET) {
+			int onlyIPv6 = 0;
+
+			if (setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&onlyIPv6, sizeof(onlyIPv6)) != 0) {
+				closesocket(socket);
+
+				*error = RIOSOCKETS_ERROR_SOCKET_DUAL_STACK;
+
+				return -1;
+			}
+
+			rio = (Rio*)calloc(1, sizeof(Rio));
+
+			rio->socket = socket;
+			rio->maxBufferLength = maxBufferLength;
+			rio->zeroCopyThreshold = (options->zeroCopyThreshold > 0 ? options->zeroCopyThreshold : RIOSOCKETS_ZEROCOPY_THRESHOLD);
+			rio->callback = options->callback;
+			rio->flags = options->flags;
+			rio->numaNode = (options->flags & RIOSOCKETS_FLAG_NUMA) ? options->numaNode : -1;
+
+			riosockets_backend_configure(rio);
+
+			rio->receiveBufferLength = riosockets_backend_receive_length(rio);
+			rio->pool = (RioArena*)options->pool;
+
+			if (rio->pool != NULL) {
+				if (maxBufferLength < 1 || (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) || riosockets_send_reservation(maxBufferLength, TRUE) > rio->pool->slotLength || rio->receiveBufferLength + RIOSOCKETS_POOL_ADDRESS_LENGTH > rio->pool->slotLength) {
+					*error = RIOSOCKETS_ERROR_POOL;
+
+					goto destroy;
+				}
+
+				rio->sendBufferCount = rio->pool->socketQuota;
+				rio->receiveBufferCount = rio->pool->socketQuota;
+				rio->receiveTarget = (RIOSOCKETS_POOL_RECEIVE_TARGET < rio->receiveBufferCount ? RIOSOCKETS_POOL_RECEIVE_TARGET : rio->receiveBufferCount);
+			} else {
+				if (maxBufferLength < 1 || sendBufferSize < riosockets_send_reservation(maxBufferLength, TRUE) || receiveBufferSize < rio->receiveBufferLength) {
+					*error = RIOSOCKETS_ERROR_RIO_BUFFER_SIZE;
+
+					goto destroy;
+				}
+
+				rio->sendBufferCount = sendBufferSize / RIOSOCKETS_SEND_ALIGNMENT;
+				rio->sendMemoryLength = rio->sendBufferCount * RIOSOCKETS_SEND_ALIGNMENT;
+
+				if (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) {
+					while (rio->sendBufferCount & (rio->sendBufferCount - 1)) {
+						rio->sendBufferCount &= rio->sendBufferCount - 1;
+					}
+				}
+
+				rio->receiveBufferCount = receiveBufferSize / rio->receiveBufferLength;
+			}
+
+			rio->receiveCallbackSlot = -1;
+			rio->receiveCallbackPeer = -1;
+			rio->receiveCompletions = (RioCompletion*)calloc(RIOSOCKETS_MAX_COMPLETION_RESULTS, sizeof(RioCompletion));
+			rio->receiveReferences = (int*)calloc(rio->receiveBufferCount, sizeof(int));
+
+			if (options->maxPeers > 0) {
+				unsigned peerTableEntries = 1;
+
+				while (peerTableEntries < (unsigned)options->maxPeers * 2) {
+					peerTableEntries <<= 1;
+				}
+
+				rio->peerTable = (RioPeerEntry*)malloc(peerTableEntries * sizeof(RioPeerEntry));
+				rio->peerAddresses = (struct sockaddr_in6*)calloc(options->maxPeers, sizeof(struct sockaddr_in6));
+				rio->peerFree = (int*)calloc(options->maxPeers, sizeof(int));
+				rio->peerCapacity = options->maxPeers;
+				rio->peerMask = peerTableEntries - 1;
+
+				for (unsigned i = 0; i < peerTableEntries; i++) {
+					rio->peerTable[i].peer = -1;
+				}
+
+				while (rio->peerFreeCount < rio->peerCapacity) {
+					rio->peerFree[rio->peerFreeCount] = rio->peerCapacity - rio->peerFreeCount - 1;
+					++rio->peerFreeCount;
+				}
+			}
+
+			if (options->flags & RIOSOCKETS_FLAG_BUNDLE) {
+				if (maxBufferLength <= RIOSOCKETS_BUNDLE_HEADER + RIOSOCKETS_BUNDLE_FRAME || maxBufferLength > UINT16_MAX) {
+					*error = RIOSOCKETS_ERROR_RIO_BUFFER_SIZE;
+
+					goto destroy;
+				}
+
+				rio->bundles = (RioBundle*)calloc(RIOSOCKETS_BUNDLE_DESTINATIONS, sizeof(RioBundle));
+			}
+
+			if (options->pacingRate > 0 || options->pacingTotalRate > 0) {
+				uint64_t burst = (uint64_t)(options->pacingBurst > 0 ? options->pacingBurst : maxBufferLength);
+				int slotCount = RIOSOCKETS_PACING_INNER_SLOTS * 2 + RIOSOCKETS_PACING_OUTER_SLOTS;
+
+				rio->pacer = (RioPacer*)calloc(1, sizeof(RioPacer));
+				rio->pacer->buckets = (RioPacingBucket*)calloc(RIOSOCKETS_PACING_BUCKETS, sizeof(RioPacingBucket));
+				rio->pacer->slots = (int*)malloc(slotCount * sizeof(int));
+				rio->pacer->tails = (int*)malloc(slotCount * sizeof(int));
+				rio->pacer->links = (int*)calloc(rio->sendBufferCount, sizeof(int));
+				rio->pacer->ticks = (uint64_t*)calloc(rio->sendBufferCount, sizeof(uint64_t));
+				rio->pacer->release = (int*)calloc(rio->sendBufferCount, sizeof(int));
+				rio->pacer->rate = options->pacingRate;
+				rio->pacer->totalRate = options->pacingTotalRate;
+				rio->pacer->tolerance = (options->pacingRate > 0 ? burst * 1000000000 / options->pacingRate : 0);
+				rio->pacer->totalTolerance = (options->pacingTotalRate > 0 ? burst * 1000000000 / options->pacingTotalRate : 0);
+				rio->pacer->tick = riosockets_clock() / RIOSOCKETS_PACING_GRANULARITY;
+
+				for (int i = 0; i < slotCount; i++) {
+					rio->pacer->slots[i] = -1;
+					rio->pacer->tails[i] = -1;
+				}
+			}
+
+			if (options->maxSegments > 0) {
+				rio->segmentLength = (int)riosockets_round_up(maxBufferLength, RIOSOCKETS_SEND_ALIGNMENT);
+				rio->segmentMemory = riosockets_buffer_allocate(rio->flags, rio->numaNode, rio->segmentLength, options->maxSegments);
+
+				if (rio->segmentMemory == NULL) {
+					*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+
+					goto destroy;
+				}
+
+				rio->segmentReferences = (int*)calloc(options->maxSegments, sizeof(int));
+				rio->segmentLengths = (int*)calloc(options->maxSegments, sizeof(int));
+				rio->segmentFree = (int*)calloc(options->maxSegments, sizeof(int));
+				rio->segmentCount = options->maxSegments;
+
+				while (rio->segmentFreeCount < rio->segmentCount) {
+					rio->segmentFree[rio->segmentFreeCount] = rio->segmentCount - rio->segmentFreeCount - 1;
+					++rio->segmentFreeCount;
+				}
+			}
+
+			if (options->captureFile != NULL) {
+				rio->capture = riosockets_capture_open(options->captureFile, (options->captureSize > 0 ? options->captureSize : RIOSOCKETS_CAPTURE_SIZE));
+
+				if (rio->capture == NULL) {
+					*error = RIOSOCKETS_ERROR_CAPTURE;
+
+					goto destroy;
+				}
+			}
+
+			#ifndef _WIN32
+				if (options->flags & RIOSOCKETS_FLAG_SHARED_MEMORY) {
+					int sharedMemorySize = (options->sharedMemorySize > 0 ? options->sharedMemorySize : RIOSOCKETS_SHM_SIZE);
+
+					if (sharedMemorySize > RIOSOCKETS_SHM_MAX_SIZE || (int)riosockets_shm_record_length(maxBufferLength) * 2 > sharedMemorySize) {
+						*error = RIOSOCKETS_ERROR_RIO_BUFFER_SIZE;
+
+						goto destroy;
+					}
+
+					rio->shm = (RioShm*)calloc(1, sizeof(RioShm));
+					rio->shm->reads = (uint64_t*)calloc(RIOSOCKETS_SHM_LANES, sizeof(uint64_t));
+					rio->shm->peers = (RioShmPeer*)calloc(RIOSOCKETS_SHM_PEERS, sizeof(RioShmPeer));
+					rio->shm->laneLength = (int)riosockets_round_up(sharedMemorySize, RIOSOCKETS_SHM_ALIGNMENT);
+				}
+			#endif
+
+			if (riosockets_backend_create(rio, error) != 0)
+				goto destroy;
+
+			if (rio->pool != NULL) {
+				rio->receiveIdle = (int*)calloc(rio->receiveBufferCount, sizeof(int));
+
+				for (int i = rio->receiveBufferCount - 1; i >= 0; i--) {
+					rio->receiveIdle[rio->receiveIdleCount++] = i;
+				}
+
+				riosockets_pool_replenish(rio);
+				riosockets_backend_commit(rio);
+			}
+
+			goto create;
+
+			destroy:
+
+			riosockets_destroy((RioSocket*)&rio);
+
+			return -1;
+		} else {
+			*error = RIOSOCKETS_ERROR_SOCKET_CREATION;
+
+			return -1;
+		}
+
+		create:
+
+		return (RioSocket)rio;
+	}
+
+	void riosockets_destroy(RioSocket* socket) {
 		Rio* rio = (Rio*)*socket;
 
-		if (rio->socket > 0) {
-			rio->functions.RIODeregisterBuffer(rio->sendBuffers[0].data.BufferId);
-			rio->functions.RIODeregisterBuffer(rio->sendBuffers[0].address.BufferId);
-			rio->functions.RIODeregisterBuffer(rio->receiveBuffers[0].data.BufferId);
-			rio->functions.RIODeregisterBuffer(rio->receiveBuffers[0].address.BufferId);
+		if (rio->socket > 0) {
+			riosockets_backend_destroy(rio);
+
+			if (rio->receiveIdle != NULL)
+				riosockets_pool_clear(rio);
+
+			free(rio->receiveIdle);
+			free(rio->sendBuffers);
+			free(rio->receiveBuffers);
+			free(rio->receiveCompletions);
+			free(rio->receiveReferences);
+			free(rio->peerTable);
+			free(rio->peerAddresses);
+			free(rio->peerFree);
+			free(rio->segmentReferences);
+			free(rio->segmentLengths);
+			free(rio->segmentFree);
+			free(rio->bundles);
+
+			if (rio->pacer != NULL) {
+				free(rio->pacer->buckets);
+				free(rio->pacer->slots);
+				free(rio->pacer->tails);
+				free(rio->pacer->links);
+				free(rio->pacer->ticks);
+				free(rio->pacer->release);
+				free(rio->pacer);
+			}
+
+			if (rio->segmentMemory != NULL)
+				riosockets_buffer_free(rio->flags, rio->segmentMemory, rio->segmentLength, rio->segmentCount);
+
+			if (rio->capture != NULL)
+				riosockets_capture_close(rio->capture);
+
+			if (rio->shm != NULL)
+				riosockets_shm_destroy(rio);
+
+			free(rio);
+
+			*socket = 0;
+		}
+	}
+
+	int riosockets_bind(RioSocket socket, const RioAddress* address) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1)
+			return -1;
+
+		struct sockaddr_in6 socketAddress = { 0 };
+
+		socketAddress.sin6_family = AF_INET6;
+
+		if (address == NULL) {
+			socketAddress.sin6_addr = in6addr_any;
+			socketAddress.sin6_port = 0;
+		} else {
+			socketAddress.sin6_addr = address->ipv6;
+			socketAddress.sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
+		}
+
+		int result = bind(rio->socket, (struct sockaddr*)&socketAddress, sizeof(socketAddress));
+
+		if (result == 0 && rio->shm != NULL)
+			riosockets_shm_inbox(rio);
+
+		return result;
+	}
+
+	int riosockets_connect(RioSocket socket, const RioAddress* address) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1)
+			return -1;
+
+		struct sockaddr_in6 socketAddress = { 0 };
+
+		socketAddress.sin6_family = AF_INET6;
+		socketAddress.sin6_addr = address->ipv6;
+		socketAddress.sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
+
+		if (rio->capture != NULL)
+			rio->capture->remote = *address;
+
+		int result = connect(rio->socket, (struct sockaddr*)&socketAddress, sizeof(socketAddress));
+
+		#ifndef _WIN32
+			if (result == 0 && rio->shm != NULL) {
+				rio->shm->remotePort = address->port;
+				rio->shm->remoteLoopback = riosockets_shm_loopback(address);
+
+				riosockets_shm_inbox(rio);
+			}
+		#endif
+
+		return result;
+	}
+
+	RioStatus riosockets_set_option(RioSocket socket, int level, int optionName, const int* optionValue, int optionLength) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && setsockopt(rio->socket, level, optionName, (const char*)optionValue, optionLength) == 0)
+			return RIOSOCKETS_STATUS_OK;
+		else
+			return RIOSOCKETS_STATUS_ERROR;
+	}
+
+	RioStatus riosockets_get_option(RioSocket socket, int level, int optionName, int* optionValue, int* optionLength) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && getsockopt(rio->socket, level, optionName, (char*)optionValue, (socklen_t*)optionLength) == 0)
+			return RIOSOCKETS_STATUS_OK;
+		else
+			return RIOSOCKETS_STATUS_ERROR;
+	}
+
+	static uint8_t* riosockets_buffer_fill(Rio* rio, RioBuffer* sendBuffer, const struct sockaddr_in6* socketAddress, int dataLength, int sendMemoryOffset, int reservedLength) {
+		sendBuffer->data.Offset = sendMemoryOffset;
+		sendBuffer->data.Length = dataLength;
+		sendBuffer->reservedLength = reservedLength;
+		sendBuffer->gatherCount = 0;
+
+		if (socketAddress == NULL) {
+			sendBuffer->addressless = TRUE;
+		} else {
+			sendBuffer->address.Offset = sendMemoryOffset + (int)riosockets_round_up(dataLength, 8);
+
+			struct sockaddr_in6* destinationAddress = (struct sockaddr_in6*)(rio->sendMemory + sendBuffer->address.Offset);
+
+			*destinationAddress = *socketAddress;
+
+			sendBuffer->addressless = FALSE;
+		}
+
+		return (uint8_t*)(rio->sendMemory + sendMemoryOffset);
+	}
+
+	static int riosockets_send_allocate(Rio* rio, int reservedLength, int* allocatedLength) {
+		if (rio->pool != NULL) {
+			int slot = (reservedLength <= rio->pool->slotLength ? riosockets_pool_acquire(rio) : -1);
+
+			*allocatedLength = rio->pool->slotLength;
+
+			return slot < 0 ? -1 : slot * rio->pool->slotLength;
+		}
+
+		if (rio->sendMemoryUsed == 0)
+			rio->sendMemoryTail = 0;
+
+		int skippedLength = 0;
+		int sendMemoryOffset = rio->sendMemoryTail;
+
+		if (sendMemoryOffset + reservedLength > rio->sendMemoryLength) {
+			skippedLength = rio->sendMemoryLength - sendMemoryOffset;
+			sendMemoryOffset = 0;
+		}
+
+		if (rio->sendMemoryUsed + skippedLength + reservedLength > rio->sendMemoryLength)
+			return -1;
+
+		rio->sendMemoryUsed += skippedLength + reservedLength;
+		rio->sendMemoryTail = sendMemoryOffset + reservedLength;
+
+		if (rio->sendMemoryTail == rio->sendMemoryLength)
+			rio->sendMemoryTail = 0;
+
+		*allocatedLength = skippedLength + reservedLength;
+
+		return sendMemoryOffset;
+	}
+
+	static uint8_t* riosockets_buffer_acquire(Rio* rio, const struct sockaddr_in6* address, int dataLength, const int* segments, int segmentCount) {
+		if (rio->socket < 1 || (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) || dataLength < 0 || dataLength > rio->maxBufferLength)
+			return NULL;
+
+		int allocatedLength = 0;
+		int sendMemoryOffset = -1;
+
+		if (rio->sendBufferPending + rio->sendBufferQueue < rio->sendBufferCount)
+			sendMemoryOffset = riosockets_send_allocate(rio, riosockets_send_reservation((int)riosockets_round_up(dataLength, 8) + segmentCount * (int)sizeof(int), address != NULL), &allocatedLength);
+
+		if (sendMemoryOffset < 0) {
+			RIOSOCKETS_STATS_ADD(rio, sendRejections, 1);
+
+			return NULL;
+		}
+
+		RioBuffer* sendBuffer = &rio->sendBuffers[rio->sendBufferTail];
+		uint8_t* buffer = riosockets_buffer_fill(rio, sendBuffer, address, dataLength, sendMemoryOffset, allocatedLength);
+
+		if (segmentCount != 0) {
+			memcpy(riosockets_send_segments(rio, sendBuffer), segments, sizeof(int) * segmentCount);
+
+			for (int i = 0; i < segmentCount; i++) {
+				++rio->segmentReferences[segments[i]];
+			}
+
+			sendBuffer->gatherCount = segmentCount;
+		}
+
+		++rio->sendBufferQueue;
+		++rio->sendBufferTail;
+
+		if (rio->sendBufferTail == rio->sendBufferCount)
+			rio->sendBufferTail = 0;
+
+		return buffer;
+	}
+
+	// An open bundle grows in place while its reservation ends at the tail of the ring, the address behind the data is written when it's sealed
+
+	static BOOL riosockets_bundle_grow(Rio* rio, RioBuffer* sendBuffer, int dataLength) {
+		int reservedLength = riosockets_send_reservation((int)sendBuffer->data.Length, !sendBuffer->addressless);
+		int extendedLength = riosockets_send_reservation(dataLength, !sendBuffer->addressless);
+		int extraLength = extendedLength - reservedLength;
+
+		if (extraLength == 0)
+			return TRUE;
+
+		if (rio->pool != NULL)
+			return extendedLength <= rio->pool->slotLength;
+
+		if ((int)sendBuffer->data.Offset + reservedLength != rio->sendMemoryTail || rio->sendMemoryTail + extraLength > rio->sendMemoryLength || rio->sendMemoryUsed + extraLength > rio->sendMemoryLength)
+			return FALSE;
+
+		rio->sendMemoryUsed += extraLength;
+		rio->sendMemoryTail += extraLength;
+		sendBuffer->reservedLength += extraLength;
+
+		if (rio->sendMemoryTail == rio->sendMemoryLength)
+			rio->sendMemoryTail = 0;
+
+		return TRUE;
+	}
+
+	static void riosockets_bundle_seal(Rio* rio, const RioBundle* bundle) {
+		RioBuffer* sendBuffer = &rio->sendBuffers[bundle->sendBufferIndex];
+
+		if (!sendBuffer->addressless) {
+			sendBuffer->address.Offset = sendBuffer->data.Offset + (int)riosockets_round_up(sendBuffer->data.Length, 8);
+
+			*(struct sockaddr_in6*)(rio->sendMemory + sendBuffer->address.Offset) = bundle->address;
+		}
+	}
+
+	// Messages for a destination are appended to the datagram that was opened for it since the last send, the datagram reserves only what its messages take
+
+	static uint8_t* riosockets_bundle_acquire(Rio* rio, const struct sockaddr_in6* address, int dataLength) {
+		RioBundle* bundle = NULL;
+
+		if (rio->socket < 1 || dataLength < 0 || dataLength > rio->maxBufferLength - RIOSOCKETS_BUNDLE_HEADER - RIOSOCKETS_BUNDLE_FRAME)
+			return NULL;
+
+		for (int i = 0; i < rio->bundleCount; i++) {
+			RioBundle* candidate = &rio->bundles[i];
+
+			if (address == NULL ? candidate->addressless : (!candidate->addressless && candidate->address.sin6_port == address->sin6_port && memcmp(&candidate->address.sin6_addr, &address->sin6_addr, sizeof(struct in6_addr)) == 0)) {
+				bundle = candidate;
+
+				break;
+			}
+		}
+
+		if (bundle != NULL) {
+			RioBuffer* sendBuffer = &rio->sendBuffers[bundle->sendBufferIndex];
+			int bundleLength = (int)sendBuffer->data.Length + RIOSOCKETS_BUNDLE_FRAME + dataLength;
+
+			if (bundleLength <= rio->maxBufferLength && riosockets_bundle_grow(rio, sendBuffer, bundleLength)) {
+				uint8_t* buffer = (uint8_t*)(rio->sendMemory + sendBuffer->data.Offset + sendBuffer->data.Length);
+
+				sendBuffer->data.Length = bundleLength;
+
+				RIOSOCKETS_STATS_ADD(rio, bundledMessages, 1);
+
+				return riosockets_bundle_frame(buffer, dataLength);
+			}
+		}
+
+		uint8_t* buffer = riosockets_buffer_acquire(rio, address, RIOSOCKETS_BUNDLE_HEADER + RIOSOCKETS_BUNDLE_FRAME + dataLength, NULL, 0);
+
+		if (buffer == NULL)
+			return NULL;
+
+		if (bundle == NULL) {
+			if (rio->bundleCount < RIOSOCKETS_BUNDLE_DESTINATIONS) {
+				bundle = &rio->bundles[rio->bundleCount++];
+			} else {
+				bundle = &rio->bundles[rio->bundleNext];
+
+				if (++rio->bundleNext == RIOSOCKETS_BUNDLE_DESTINATIONS)
+					rio->bundleNext = 0;
+
+				riosockets_bundle_seal(rio, bundle);
+			}
+
+			bundle->addressless = (address == NULL);
+
+			if (address != NULL)
+				bundle->address = *address;
+		} else {
+			riosockets_bundle_seal(rio, bundle);
+		}
+
+		bundle->sendBufferIndex = (rio->sendBufferTail == 0 ? rio->sendBufferCount : rio->sendBufferTail) - 1;
+
+		buffer[0] = RIOSOCKETS_BUNDLE_MAGIC;
+		buffer[1] = RIOSOCKETS_BUNDLE_VERSION;
+
+		return riosockets_bundle_frame(buffer + RIOSOCKETS_BUNDLE_HEADER, dataLength);
+	}
+
+	uint8_t* riosockets_buffer(RioSocket socket, const RioAddress* address, int dataLength) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->shm != NULL && rio->socket > 0) {
+			BOOL routed = FALSE;
+			uint8_t* buffer = riosockets_shm_route(rio, address, dataLength, &routed);
+
+			if (routed)
+				return buffer;
+		}
+
+		struct sockaddr_in6 socketAddress;
+
+		if (address != NULL)
+			riosockets_address_encode(&socketAddress, address);
+
+		if (rio->bundles != NULL)
+			return riosockets_bundle_acquire(rio, (address != NULL ? &socketAddress : NULL), dataLength);
+
+		return riosockets_buffer_acquire(rio, (address != NULL ? &socketAddress : NULL), dataLength, NULL, 0);
+	}
+
+	// The shared memory route and the bundles are skipped without a check when they are left out of the features
+
+	uint8_t* riosockets_buffer_ex(RioSocket socket, const RioAddress* address, int dataLength, int features) {
+		Rio* rio = (Rio*)socket;
+
+		if ((riosockets_features(rio) & ~features) != 0)
+			return NULL;
+
+		if (features & (RIOSOCKETS_FEATURE_SHARED_MEMORY | RIOSOCKETS_FEATURE_BUNDLE))
+			return riosockets_buffer(socket, address, dataLength);
+
+		struct sockaddr_in6 socketAddress;
+
+		if (address != NULL)
+			riosockets_address_encode(&socketAddress, address);
+
+		return riosockets_buffer_acquire(rio, (address != NULL ? &socketAddress : NULL), dataLength, NULL, 0);
+	}
+
+	uint8_t* riosockets_buffer_peer(RioSocket socket, int peer, int dataLength) {
+		Rio* rio = (Rio*)socket;
+
+		if (peer < 0 || peer >= rio->peerCapacity || rio->peerAddresses[peer].sin6_family != AF_INET6)
+			return NULL;
+
+		if (rio->bundles != NULL)
+			return riosockets_bundle_acquire(rio, &rio->peerAddresses[peer], dataLength);
+
+		return riosockets_buffer_acquire(rio, &rio->peerAddresses[peer], dataLength, NULL, 0);
+	}
+
+	uint8_t* riosockets_buffer_fanout(RioSocket socket, const RioAddress* addresses, int addressCount, int dataLength) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) || addresses == NULL || addressCount < 1 || dataLength < 0 || dataLength > rio->maxBufferLength)
+			return NULL;
+
+		int reservedLength = (int)riosockets_round_up(riosockets_round_up(dataLength, 8) + sizeof(SOCKADDR_INET) * (uint64_t)addressCount, RIOSOCKETS_SEND_ALIGNMENT);
+		int allocatedLength = 0;
+		int sendMemoryOffset = -1;
+
+		if (addressCount <= rio->sendBufferCount - rio->sendBufferPending - rio->sendBufferQueue)
+			sendMemoryOffset = riosockets_send_allocate(rio, reservedLength, &allocatedLength);
+
+		if (sendMemoryOffset < 0) {
+			RIOSOCKETS_STATS_ADD(rio, sendRejections, 1);
+
+			return NULL;
+		}
+
+		// All sends reference the same payload, the memory is reclaimed with the last one since completions retire in order
+
+		for (int i = 0; i < addressCount; i++) {
+			RioBuffer* sendBuffer = &rio->sendBuffers[rio->sendBufferTail];
+
+			sendBuffer->data.Offset = sendMemoryOffset;
+			sendBuffer->data.Length = dataLength;
+			sendBuffer->address.Offset = sendMemoryOffset + (int)riosockets_round_up(dataLength, 8) + (int)sizeof(SOCKADDR_INET) * i;
+			sendBuffer->addressless = FALSE;
+			sendBuffer->reservedLength = (i == addressCount - 1 ? allocatedLength : 0);
+			sendBuffer->gatherCount = 0;
+
+			riosockets_address_encode((struct sockaddr_in6*)(rio->sendMemory + sendBuffer->address.Offset), &addresses[i]);
+
+			++rio->sendBufferQueue;
+			++rio->sendBufferTail;
+
+			if (rio->sendBufferTail == rio->sendBufferCount)
+				rio->sendBufferTail = 0;
+		}
+
+		return (uint8_t*)(rio->sendMemory + sendMemoryOffset);
+	}
+
+	uint8_t* riosockets_buffer_gather(RioSocket socket, const RioAddress* address, int dataLength, const int* segments, int segmentCount) {
+		Rio* rio = (Rio*)socket;
+		int messageLength = dataLength;
+
+		if (rio->socket < 1 || dataLength < 0 || segments == NULL || segmentCount < 1 || segmentCount > RIOSOCKETS_MAX_GATHER_SEGMENTS)
+			return NULL;
+
+		for (int i = 0; i < segmentCount; i++) {
+			if (segments[i] < 0 || segments[i] >= rio->segmentCount || rio->segmentReferences[segments[i]] == 0)
+				return NULL;
+
+			messageLength += rio->segmentLengths[segments[i]];
+		}
+
+		if (messageLength > rio->maxBufferLength)
+			return NULL;
+
+		struct sockaddr_in6 socketAddress;
+
+		if (address != NULL)
+			riosockets_address_encode(&socketAddress, address);
+
+		#ifdef RIOSOCKETS_BACKEND_RIO
+			// RIOSendEx takes a single data buffer, so the segments are flattened behind the header
+
+			uint8_t* buffer = riosockets_buffer_acquire(rio, (address != NULL ? &socketAddress : NULL), messageLength, NULL, 0);
+
+			if (buffer != NULL) {
+				for (int i = 0, offset = dataLength; i < segmentCount; i++) {
+					memcpy(buffer + offset, rio->segmentMemory + (size_t)segments[i] * rio->segmentLength, rio->segmentLengths[segments[i]]);
+
+					offset += rio->segmentLengths[segments[i]];
+				}
+			}
+
+			return buffer;
+		#else
+			return riosockets_buffer_acquire(rio, (address != NULL ? &socketAddress : NULL), dataLength, segments, segmentCount);
+		#endif
+	}
+
+	uint8_t* riosockets_segment(RioSocket socket, int dataLength, int* segment) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || segment == NULL || dataLength < 0 || dataLength > rio->maxBufferLength || rio->segmentFreeCount == 0)
+			return NULL;
+
+		int index = rio->segmentFree[--rio->segmentFreeCount];
+
+		rio->segmentReferences[index] = 1;
+		rio->segmentLengths[index] = dataLength;
+
+		*segment = index;
+
+		return (uint8_t*)(rio->segmentMemory + (size_t)index * rio->segmentLength);
+	}
+
+	void riosockets_segment_release(RioSocket socket, int segment) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && segment >= 0 && segment < rio->segmentCount && rio->segmentReferences[segment] > 0)
+			riosockets_segment_drop(rio, segment);
+	}
+
+	uint8_t* riosockets_buffer_reserve(RioSocket socket, const RioAddress* address, int dataLength, int* slot) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || !(rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) || slot == NULL || dataLength < 0 || dataLength > rio->maxBufferLength)
+			return NULL;
+
+		struct sockaddr_in6 socketAddress;
+		int reservedLength = riosockets_send_reservation(dataLength, address != NULL);
+		uint64_t reserveState = 0;
+		uint32_t ticket = 0;
+		int sendMemoryOffset = 0;
+
+		for (;;) {
+			uint64_t reclaimState = RIOSOCKETS_ATOMIC_LOAD(&rio->sendReclaimState);
+
+			reserveState = RIOSOCKETS_ATOMIC_LOAD(&rio->sendReserveState);
+
+			if (RIOSOCKETS_ATOMIC_LOAD(&rio->sendReclaimState) != reclaimState)
+				continue;
+
+			ticket = (uint32_t)(reserveState >> 32);
+
+			uint32_t outstanding = ticket - (uint32_t)(reclaimState >> 32);
+			int sendMemoryTail = (int)(uint32_t)reserveState;
+			int sendMemoryHead = (int)(uint32_t)reclaimState;
+
+			if (outstanding >= (uint32_t)rio->sendBufferCount)
+				sendMemoryOffset = -1;
+			else if (outstanding == 0)
+				sendMemoryOffset = (sendMemoryTail + reservedLength <= rio->sendMemoryLength ? sendMemoryTail : 0);
+			else if (sendMemoryTail > sendMemoryHead && sendMemoryTail + reservedLength <= rio->sendMemoryLength)
+				sendMemoryOffset = sendMemoryTail;
+			else if (sendMemoryTail > sendMemoryHead && reservedLength <= sendMemoryHead)
+				sendMemoryOffset = 0;
+			else if (sendMemoryTail < sendMemoryHead && sendMemoryTail + reservedLength <= sendMemoryHead)
+				sendMemoryOffset = sendMemoryTail;
+			else
+				sendMemoryOffset = -1;
+
+			if (sendMemoryOffset < 0) {
+				RIOSOCKETS_STATS_ATOMIC_ADD(rio, sendRejections, 1);
+
+				return NULL;
+			}
+
+			if (RIOSOCKETS_ATOMIC_CAS(&rio->sendReserveState, reserveState, ((uint64_t)(ticket + 1) << 32) | (uint32_t)((sendMemoryOffset + reservedLength) % rio->sendMemoryLength)))
+				break;
+		}
+
+		*slot = (int)ticket;
+
+		if (address != NULL)
+			riosockets_address_encode(&socketAddress, address);
+
+		return riosockets_buffer_fill(rio, &rio->sendBuffers[ticket & (rio->sendBufferCount - 1)], (address != NULL ? &socketAddress : NULL), dataLength, sendMemoryOffset, reservedLength);
+	}
+
+	void riosockets_buffer_publish(RioSocket socket, int slot) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND))
+			RIOSOCKETS_ATOMIC_STORE(&rio->sendBuffers[(uint32_t)slot & (rio->sendBufferCount - 1)].sequence, (uint64_t)((uint32_t)slot + 1));
+	}
+
+	inline static void riosockets_pacing_push(RioPacer* pacer, int slot, int sendBufferIndex) {
+		pacer->links[sendBufferIndex] = -1;
+
+		if (pacer->tails[slot] < 0)
+			pacer->slots[slot] = sendBufferIndex;
+		else
+			pacer->links[pacer->tails[slot]] = sendBufferIndex;
+
+		pacer->tails[slot] = sendBufferIndex;
+	}
+
+	static void riosockets_pacing_place(RioPacer* pacer, int sendBufferIndex) {
+		uint64_t block = pacer->tick / RIOSOCKETS_PACING_INNER_SLOTS;
+		uint64_t tick = pacer->ticks[sendBufferIndex];
+
+		// The inner wheel covers the current and the next block, later ticks wait in the outer wheel and cascade one block ahead, beyond its range they go around again
+
+		if (tick / RIOSOCKETS_PACING_INNER_SLOTS <= block + 1) {
+			riosockets_pacing_push(pacer, (int)(tick % (RIOSOCKETS_PACING_INNER_SLOTS * 2)), sendBufferIndex);
+		} else {
+			uint64_t outer = tick / RIOSOCKETS_PACING_INNER_SLOTS;
+
+			if (outer > block + RIOSOCKETS_PACING_OUTER_SLOTS)
+				outer = block + RIOSOCKETS_PACING_OUTER_SLOTS;
+
+			riosockets_pacing_push(pacer, RIOSOCKETS_PACING_INNER_SLOTS * 2 + (int)(outer % RIOSOCKETS_PACING_OUTER_SLOTS), sendBufferIndex);
+		}
+	}
+
+	static void riosockets_pacing_schedule(RioPacer* pacer, int sendBufferIndex, uint64_t tick) {
+		if (tick <= pacer->tick) {
+			pacer->release[pacer->releaseCount++] = sendBufferIndex;
+
+			return;
+		}
+
+		pacer->ticks[sendBufferIndex] = tick;
+
+		riosockets_pacing_place(pacer, sendBufferIndex);
+
+		++pacer->heldCount;
+	}
+
+	static void riosockets_pacing_advance(RioPacer* pacer, uint64_t tick) {
+		if (pacer->heldCount == 0 && tick > pacer->tick)
+			pacer->tick = tick;
+
+		while (pacer->tick < tick) {
+			++pacer->tick;
+
+			if (pacer->tick % RIOSOCKETS_PACING_INNER_SLOTS == 0) {
+				int slot = RIOSOCKETS_PACING_INNER_SLOTS * 2 + (int)((pacer->tick / RIOSOCKETS_PACING_INNER_SLOTS + 1) % RIOSOCKETS_PACING_OUTER_SLOTS);
+				int sendBufferIndex = pacer->slots[slot];
+
+				pacer->slots[slot] = -1;
+				pacer->tails[slot] = -1;
+
+				while (sendBufferIndex >= 0) {
+					int next = pacer->links[sendBufferIndex];
+
+					riosockets_pacing_place(pacer, sendBufferIndex);
+
+					sendBufferIndex = next;
+				}
+			}
+
+			int slot = (int)(pacer->tick % (RIOSOCKETS_PACING_INNER_SLOTS * 2));
+
+			for (int sendBufferIndex = pacer->slots[slot]; sendBufferIndex >= 0; sendBufferIndex = pacer->links[sendBufferIndex]) {
+				pacer->release[pacer->releaseCount++] = sendBufferIndex;
+
+				--pacer->heldCount;
+			}
+
+			pacer->slots[slot] = -1;
+			pacer->tails[slot] = -1;
+
+			if (pacer->heldCount == 0)
+				pacer->tick = tick;
+		}
+	}
+
+	static void riosockets_pacing_admit(Rio* rio, uint64_t time) {
+		RioPacer* pacer = rio->pacer;
+
+		while (rio->sendBufferQueue != 0) {
+			int sendBufferHead = riosockets_send_head(rio);
+			const RioBuffer* buffer = &rio->sendBuffers[sendBufferHead];
+			uint64_t length = (uint64_t)riosockets_send_length(rio, buffer);
+			uint64_t due = time;
+			RioPacingBucket* bucket = NULL;
+
+			// Token buckets are kept as the theoretical arrival time, a message is due once the time is within the burst tolerance
+
+			if (pacer->rate != 0) {
+				RioPeerEntry key = { 0 };
+
+				if (buffer->addressless == FALSE)
+					riosockets_peer_key(&key, (const struct sockaddr_in6*)(rio->sendMemory + buffer->address.Offset));
+
+				bucket = &pacer->buckets[riosockets_peer_hash(&key) & (RIOSOCKETS_PACING_BUCKETS - 1)];
+
+				if (!riosockets_peer_match(&bucket->key, &key) && bucket->time <= time)
+					bucket->key = key;
+
+				if (bucket->time > due + pacer->tolerance)
+					due = bucket->time - pacer->tolerance;
+			}
+
+			if (pacer->totalRate != 0) {
+				if (pacer->time > due + pacer->totalTolerance)
+					due = pacer->time - pacer->totalTolerance;
+
+				pacer->time = (pacer->time > due ? pacer->time : due) + length * 1000000000 / pacer->totalRate;
+			}
+
+			if (bucket != NULL)
+				bucket->time = (bucket->time > due ? bucket->time : due) + length * 1000000000 / pacer->rate;
+
+			if (due > time)
+				RIOSOCKETS_STATS_ADD(rio, pacedMessages, 1);
+
+			--rio->sendBufferQueue;
+			++rio->sendBufferPending;
+
+			riosockets_pacing_schedule(pacer, sendBufferHead, due / RIOSOCKETS_PACING_GRANULARITY);
+		}
+	}
+
+	static void riosockets_pacing_send(Rio* rio) {
+		RioPacer* pacer = rio->pacer;
+		uint64_t time = riosockets_clock();
+
+		riosockets_pacing_advance(pacer, time / RIOSOCKETS_PACING_GRANULARITY);
+		riosockets_pacing_admit(rio, time);
+
+		if (pacer->releaseCount != 0) {
+			int released = riosockets_backend_release(rio, pacer->release, pacer->releaseCount);
+
+			pacer->releaseCount -= released;
+
+			memmove(pacer->release, pacer->release + released, sizeof(int) * pacer->releaseCount);
+		}
+	}
+
+	void riosockets_send(RioSocket socket) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0) {
+			if (rio->shm != NULL)
+				riosockets_shm_send(rio);
+
+			for (int i = 0; i < rio->bundleCount; i++) {
+				riosockets_bundle_seal(rio, &rio->bundles[i]);
+			}
+
+			rio->bundleCount = 0;
+			rio->bundleNext = 0;
+
+			if (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND) {
+				while (RIOSOCKETS_ATOMIC_LOAD(&rio->sendBuffers[rio->sendBufferTail].sequence) == (uint64_t)(rio->sendTicket + 1)) {
+					++rio->sendTicket;
+					++rio->sendBufferQueue;
+					++rio->sendBufferTail;
+
+					if (rio->sendBufferTail == rio->sendBufferCount)
+						rio->sendBufferTail = 0;
+				}
+			}
+
+			if (rio->capture != NULL && (rio->flags & RIOSOCKETS_FLAG_CAPTURE_SEND) && rio->sendBufferQueue > rio->capture->queued)
+				riosockets_capture_send(rio);
+
+			if (rio->sendBufferQueue != 0 || (rio->pacer != NULL && (rio->pacer->heldCount != 0 || rio->pacer->releaseCount != 0))) {
+				if (rio->pacer != NULL)
+					riosockets_pacing_send(rio);
+				else
+					riosockets_backend_send(rio);
+
+				if (rio->capture != NULL)
+					rio->capture->queued = rio->sendBufferQueue;
+
+				RIOSOCKETS_STATS_PEAK(rio, sendPendingPeak, rio->sendBufferPending);
+			}
+
+			riosockets_backend_complete(rio);
+
+			if (rio->flags & RIOSOCKETS_FLAG_CONCURRENT_SEND)
+				RIOSOCKETS_ATOMIC_STORE(&rio->sendReclaimState, ((uint64_t)(rio->sendTicket - rio->sendBufferQueue - rio->sendBufferPending) << 32) | (uint32_t)rio->sendMemoryHead);
+		}
+	}
+
+	void riosockets_receive(RioSocket socket, int maxCompletions) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && maxCompletions > 0) {
+			RioMessage message = { 0 };
+			int messageCount = 0;
+			BOOL socketEmpty = FALSE;
+
+			while (messageCount < maxCompletions && riosockets_receive_next(rio, &message, maxCompletions - messageCount, &socketEmpty, RIOSOCKETS_FEATURE_ALL)) {
+				rio->receiveCallbackSlot = message.slot;
+				rio->receiveCallbackTimestamp = message.timestamp;
+				rio->receiveCallbackDequeueTimestamp = message.dequeueTimestamp;
+				rio->receiveCallbackPeer = message.peer;
+				rio->callback(socket, &message.address, message.data, message.dataLength, RIOSOCKETS_TYPE_RECEIVE);
+				rio->receiveCallbackSlot = -1;
+				rio->receiveCallbackTimestamp = 0;
+				rio->receiveCallbackDequeueTimestamp = 0;
+				rio->receiveCallbackPeer = -1;
+
+				if (message.slot & RIOSOCKETS_SHM_SLOT)
+					riosockets_shm_release(rio, message.slot);
+				else
+					riosockets_receive_release(rio, message.slot);
+
+				++messageCount;
+			}
 
-			rio->functions.RIOCloseCompletionQueue(rio->sendQueue);
-			rio->functions.RIOCloseCompletionQueue(rio->receiveQueue);
+			if (messageCount > 0)
+				riosockets_backend_commit(rio);
+		}
+	}
 
-			WSACloseEvent(rio->sendEvent);
-			WSACloseEvent(rio->receiveEvent);
+	int riosockets_wait(RioSocket socket, int timeout) {
+		Rio* rio = (Rio*)socket;
 
-			closesocket(rio->socket);
+		if (rio->socket < 1)
+			return -1;
 
-			riosockets_buffer_free(rio->sendMemory);
-			riosockets_buffer_free(rio->sendMemoryAddress);
-			riosockets_buffer_free(rio->receiveMemory);
-			riosockets_buffer_free(rio->receiveMemoryAddress);
+		uint64_t start = riosockets_clock();
+		uint64_t spinLength = riosockets_wait_budget(rio);
 
-			free(rio->sendBuffers);
-			free(rio->receiveBuffers);
-			free(rio->sendCompletionResults);
-			free(rio->receiveCompletionResults);
+		while (!riosockets_shm_pending(rio) && !riosockets_receive_fill(rio, RIOSOCKETS_MAX_COMPLETION_RESULTS)) {
+			uint64_t elapsed = riosockets_clock() - start;
 
-			free(rio);
+			if (elapsed < spinLength)
+				continue;
 
-			*socket = 0;
+			if (timeout >= 0 && elapsed >= (uint64_t)timeout * 1000000)
+				return 0;
+
+			int remaining = (timeout < 0 ? -1 : timeout - (int)(elapsed / 1000000));
+
+			if ((rio->shm != NULL && rio->shm->inbox != NULL ? riosockets_shm_wait(rio, remaining) : riosockets_backend_wait(rio, remaining)) < 0)
+				return -1;
 		}
+
+		uint64_t arrival = riosockets_clock();
+
+		if (rio->receiveArrival != 0)
+			rio->receiveInterval = (rio->receiveInterval == 0 ? arrival - rio->receiveArrival : rio->receiveInterval - rio->receiveInterval / 8 + (arrival - rio->receiveArrival) / 8);
+
+		rio->receiveArrival = arrival;
+
+		return 1;
 	}
 
-	int riosockets_bind(RioSocket socket, const RioAddress* address) {
+	// Sends that are queued or held by the pacer need the next call to riosockets_send(), so the wait is cut short for them
+
+	inline static BOOL riosockets_wait_sends(const Rio* rio) {
+		return rio->sendBufferQueue != 0 || (rio->pacer != NULL && (rio->pacer->heldCount != 0 || rio->pacer->releaseCount != 0));
+	}
+
+	#ifdef RIOSOCKETS_BACKEND_RIO
+		int riosockets_wait_any(const RioSocket* sockets, int socketCount, int timeout) {
+			HANDLE events[RIOSOCKETS_MAX_WAIT_SOCKETS * 2];
+			DWORD eventCount = 0;
+
+			if (sockets == NULL || socketCount < 1 || socketCount > RIOSOCKETS_MAX_WAIT_SOCKETS)
+				return -1;
+
+			for (int i = 0; i < socketCount; i++) {
+				Rio* rio = (Rio*)sockets[i];
+
+				if (rio->socket < 1)
+					return -1;
+
+				if (riosockets_receive_fill(rio, RIOSOCKETS_MAX_COMPLETION_RESULTS))
+					return 1;
+
+				INT notifyResult = rio->functions.RIONotify(rio->receiveQueue);
+
+				if (notifyResult != ERROR_SUCCESS && notifyResult != WSAEALREADY)
+					return -1;
+
+				events[eventCount++] = rio->receiveEvent;
+
+				if (rio->sendBufferPending != 0) {
+					notifyResult = rio->functions.RIONotify(rio->sendQueue);
+
+					if (notifyResult != ERROR_SUCCESS && notifyResult != WSAEALREADY)
+						return -1;
+
+					events[eventCount++] = rio->sendEvent;
+				}
+
+				if (riosockets_wait_sends(rio) && (timeout < 0 || timeout > 1))
+					timeout = 1;
+			}
+
+			DWORD waitResult = WaitForMultipleObjects(eventCount, events, FALSE, (timeout < 0 ? INFINITE : (DWORD)timeout));
+
+			if (waitResult == WAIT_TIMEOUT)
+				return 0;
+
+			return waitResult < WAIT_OBJECT_0 + eventCount ? 1 : -1;
+		}
+	#else
+		// Polls the receive side of every socket together with the wake-up sockets of the inboxes, and the send ring of the sockets with sends in flight
+
+		int riosockets_wait_any(const RioSocket* sockets, int socketCount, int timeout) {
+			struct pollfd descriptors[RIOSOCKETS_MAX_WAIT_SOCKETS * 3];
+			int descriptorCount = 0;
+			int result = 0;
+
+			if (sockets == NULL || socketCount < 1 || socketCount > RIOSOCKETS_MAX_WAIT_SOCKETS)
+				return -1;
+
+			for (int i = 0; i < socketCount; i++) {
+				Rio* rio = (Rio*)sockets[i];
+
+				if (rio->socket < 1)
+					return -1;
+
+				if (riosockets_shm_pending(rio) || riosockets_receive_fill(rio, RIOSOCKETS_MAX_COMPLETION_RESULTS))
+					return 1;
+			}
+
+			for (int i = 0; i < socketCount; i++) {
+				Rio* rio = (Rio*)sockets[i];
+
+				descriptors[descriptorCount].fd = riosockets_backend_descriptor(rio);
+				descriptors[descriptorCount].events = POLLIN;
+				descriptors[descriptorCount++].revents = 0;
+
+				if (rio->sendBufferPending != 0 && riosockets_backend_send_descriptor(rio) >= 0) {
+					descriptors[descriptorCount].fd = riosockets_backend_send_descriptor(rio);
+					descriptors[descriptorCount].events = POLLIN;
+					descriptors[descriptorCount++].revents = 0;
+				}
+
+				if (rio->shm != NULL && rio->shm->inbox != NULL) {
+					descriptors[descriptorCount].fd = rio->shm->wakeFile;
+					descriptors[descriptorCount].events = POLLIN;
+					descriptors[descriptorCount++].revents = 0;
+
+					if (riosockets_shm_announce(rio))
+						timeout = 0;
+				}
+
+				if (riosockets_wait_sends(rio) && (timeout < 0 || timeout > 1))
+					timeout = 1;
+			}
+
+			result = poll(descriptors, descriptorCount, timeout);
+
+			if (result < 0)
+				result = (errno == EINTR ? 0 : -1);
+
+			for (int i = 0; i < socketCount; i++) {
+				Rio* rio = (Rio*)sockets[i];
+
+				if (rio->shm != NULL && rio->shm->inbox != NULL) {
+					if (riosockets_shm_pending(rio))
+						result = 1;
+
+					riosockets_shm_settle(rio);
+				}
+			}
+
+			return result > 0 ? 1 : result;
+		}
+	#endif
+
+	RIOSOCKETS_INLINE int riosockets_receive_batch_features(Rio* rio, RioMessage* messages, int maxMessages, const int features) {
+		int messageCount = 0;
+		BOOL socketEmpty = FALSE;
+
+		while (messageCount < maxMessages && riosockets_receive_next(rio, &messages[messageCount], maxMessages - messageCount, &socketEmpty, features)) {
+			++messageCount;
+		}
+
+		return messageCount;
+	}
+
+	int riosockets_receive_batch(RioSocket socket, RioMessage* messages, int maxMessages) {
 		Rio* rio = (Rio*)socket;
 
-		if (rio->socket < 1)
+		if (rio->socket < 1 || messages == NULL)
 			return -1;
 
-		struct sockaddr_in6 socketAddress = { 0 };
+		return riosockets_receive_batch_features(rio, messages, maxMessages, RIOSOCKETS_FEATURE_ALL);
+	}
 
-		socketAddress.sin6_family = AF_INET6;
+	#define RIOSOCKETS_RECEIVE_FEATURES(features) case (features): return riosockets_receive_batch_features(rio, messages, maxMessages, (features) | RIOSOCKETS_FEATURE_SHARED_MEMORY)
 
-		if (address == NULL) {
-			socketAddress.sin6_addr = in6addr_any;
-			socketAddress.sin6_port = 0;
-		} else {
-			socketAddress.sin6_addr = address->ipv6;
-			socketAddress.sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
+	// Every combination of the features that can be left out has a loop of its own, shared memory is always kept since it costs a single check per message
+
+	int riosockets_receive_batch_ex(RioSocket socket, RioMessage* messages, int maxMessages, int features) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || messages == NULL || (riosockets_features(rio) & ~features) != 0)
+			return -1;
+
+		switch (features & (RIOSOCKETS_FEATURE_STATS | RIOSOCKETS_FEATURE_PEERS | RIOSOCKETS_FEATURE_COALESCING | RIOSOCKETS_FEATURE_BUNDLE)) {
+			RIOSOCKETS_RECEIVE_FEATURES(0);
+			RIOSOCKETS_RECEIVE_FEATURES(1);
+			RIOSOCKETS_RECEIVE_FEATURES(2);
+			RIOSOCKETS_RECEIVE_FEATURES(3);
+			RIOSOCKETS_RECEIVE_FEATURES(4);
+			RIOSOCKETS_RECEIVE_FEATURES(5);
+			RIOSOCKETS_RECEIVE_FEATURES(6);
+			RIOSOCKETS_RECEIVE_FEATURES(7);
+			RIOSOCKETS_RECEIVE_FEATURES(8);
+			RIOSOCKETS_RECEIVE_FEATURES(9);
+			RIOSOCKETS_RECEIVE_FEATURES(10);
+			RIOSOCKETS_RECEIVE_FEATURES(11);
+			RIOSOCKETS_RECEIVE_FEATURES(12);
+			RIOSOCKETS_RECEIVE_FEATURES(13);
+			RIOSOCKETS_RECEIVE_FEATURES(14);
+			default:
+				return riosockets_receive_batch_features(rio, messages, maxMessages, RIOSOCKETS_FEATURE_ALL);
 		}
+	}
+
+	#undef RIOSOCKETS_RECEIVE_FEATURES
+
+	void riosockets_release_batch(RioSocket socket, const RioMessage* messages, int messageCount) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket > 0 && messages != NULL && messageCount > 0) {
+			for (int i = 0; i < messageCount; i++) {
+				if (messages[i].slot >= 0 && (messages[i].slot & RIOSOCKETS_SHM_SLOT))
+					riosockets_shm_release(rio, messages[i].slot);
+				else
+					riosockets_receive_release(rio, messages[i].slot);
+			}
 
-		return bind(rio->socket, (struct sockaddr*)&socketAddress, sizeof(socketAddress));
+			riosockets_backend_commit(rio);
+		}
 	}
 
-	int riosockets_connect(RioSocket socket, const RioAddress* address) {
+	int riosockets_retain(RioSocket socket) {
 		Rio* rio = (Rio*)socket;
 
-		if (rio->socket < 1)
+		if (rio->socket < 1 || rio->receiveCallbackSlot < 0)
 			return -1;
 
-		struct sockaddr_in6 socketAddress = { 0 };
+		if (rio->receiveCallbackSlot & RIOSOCKETS_SHM_SLOT) {
+			riosockets_shm_retain(rio, rio->receiveCallbackSlot);
 
-		socketAddress.sin6_family = AF_INET6;
-		socketAddress.sin6_addr = address->ipv6;
-		socketAddress.sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
+			return rio->receiveCallbackSlot;
+		}
+
+		++rio->receiveReferences[rio->receiveCallbackSlot];
 
-		return connect(rio->socket, (struct sockaddr*)&socketAddress, sizeof(socketAddress));
+		return rio->receiveCallbackSlot;
 	}
 
-	RioStatus riosockets_set_option(RioSocket socket, int level, int optionName, const int* optionValue, int optionLength) {
+	void riosockets_release(RioSocket socket, int slot) {
 		Rio* rio = (Rio*)socket;
 
-		if (rio->socket > 0 && setsockopt(rio->socket, level, optionName, (const char*)optionValue, optionLength) == 0)
-			return RIOSOCKETS_STATUS_OK;
-		else
-			return RIOSOCKETS_STATUS_ERROR;
+		if (rio->socket > 0 && rio->shm != NULL && slot >= 0 && (slot & RIOSOCKETS_SHM_SLOT)) {
+			riosockets_shm_release(rio, slot);
+
+			return;
+		}
+
+		if (rio->socket > 0 && slot >= 0 && slot < rio->receiveBufferCount && rio->receiveReferences[slot] > 0) {
+			riosockets_receive_release(rio, slot);
+
+			if (rio->receiveReferences[slot] == 0)
+				riosockets_backend_commit(rio);
+		}
 	}
 
-	RioStatus riosockets_get_option(RioSocket socket, int level, int optionName, int* optionValue, int* optionLength) {
+	uint64_t riosockets_receive_timestamp(RioSocket socket) {
 		Rio* rio = (Rio*)socket;
 
-		if (rio->socket > 0 && getsockopt(rio->socket, level, optionName, (char*)optionValue, (socklen_t*)optionLength) == 0)
-			return RIOSOCKETS_STATUS_OK;
-		else
+		if (rio->socket < 1 || rio->receiveCallbackSlot < 0)
+			return 0;
+
+		return rio->receiveCallbackTimestamp;
+	}
+
+	uint64_t riosockets_receive_dequeue_timestamp(RioSocket socket) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || rio->receiveCallbackSlot < 0)
+			return 0;
+
+		return rio->receiveCallbackDequeueTimestamp;
+	}
+
+	int riosockets_receive_peer(RioSocket socket) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || rio->receiveCallbackSlot < 0)
+			return -1;
+
+		return rio->receiveCallbackPeer;
+	}
+
+	int riosockets_peer_register(RioSocket socket, const RioAddress* address) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || rio->peerTable == NULL || address == NULL)
+			return -1;
+
+		struct sockaddr_in6 socketAddress;
+
+		riosockets_address_encode(&socketAddress, address);
+
+		return riosockets_peer_find(rio, &socketAddress);
+	}
+
+	void riosockets_peer_remove(RioSocket socket, int peer) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || peer < 0 || peer >= rio->peerCapacity || rio->peerAddresses[peer].sin6_family != AF_INET6)
+			return;
+
+		RioPeerEntry key = { 0 };
+
+		riosockets_peer_key(&key, &rio->peerAddresses[peer]);
+
+		unsigned index = riosockets_peer_probe(rio, &key);
+
+		if (rio->peerTable[index].peer == peer)
+			riosockets_peer_erase(rio, index);
+
+		rio->peerAddresses[peer].sin6_family = 0;
+		rio->peerFree[rio->peerFreeCount++] = peer;
+	}
+
+	RioStatus riosockets_peer_address(RioSocket socket, int peer, RioAddress* address) {
+		Rio* rio = (Rio*)socket;
+
+		if (rio->socket < 1 || peer < 0 || peer >= rio->peerCapacity || rio->peerAddresses[peer].sin6_family != AF_INET6 || address == NULL)
 			return RIOSOCKETS_STATUS_ERROR;
+
+		riosockets_address_extract(address, (const struct sockaddr_storage*)&rio->peerAddresses[peer]);
+
+		return RIOSOCKETS_STATUS_OK;
 	}
 
-	uint8_t* riosockets_buffer(RioSocket socket, const RioAddress* address, int dataLength) {
+	RioStatus riosockets_get_stats(RioSocket socket, RioStats* stats) {
 		Rio* rio = (Rio*)socket;
 
-		if (rio->socket < 1 || rio->sendBufferPending == rio->sendBufferCount || dataLength > rio->maxBufferLength)
-			return NULL;
+		if (rio->socket < 1 || stats == NULL)
+			return RIOSOCKETS_STATUS_ERROR;
 
-		if (rio->sendBufferTail == rio->sendBufferCount)
-			rio->sendBufferTail = 0;
+		#ifdef RIOSOCKETS_NO_STATS
+			memset(stats, 0, sizeof(RioStats));
 
-		uint8_t* buffer = (uint8_t*)(rio->sendMemory + rio->sendBufferTail * rio->maxBufferLength);
+			return RIOSOCKETS_STATUS_ERROR;
+		#else
+			*stats = rio->stats;
 
-		rio->sendBuffers[rio->sendBufferTail].data.Length = dataLength;
+			return RIOSOCKETS_STATUS_OK;
+		#endif
+	}
 
-		if (address == NULL) {
-			rio->sendBuffers[rio->sendBufferTail].addressless = TRUE;
-		} else {
-			struct sockaddr_in6 socketAddress = { 0 };
+	RioPool riosockets_pool_create(const RioPoolOptions* options, RioError* error) {
+		if (options == NULL || error == NULL)
+			return -1;
 
-			socketAddress.sin6_family = AF_INET6;
-			socketAddress.sin6_addr = address->ipv6;
-			socketAddress.sin6_port = RIOSOCKETS_HOST_TO_NET_16(address->port);
+		uint64_t slotLength = riosockets_round_up((uint64_t)options->maxBufferLength + RIOSOCKETS_POOL_SLOT_OVERHEAD, 64);
+
+		if (options->maxBufferLength < 1 || options->bufferCount < 1 || options->socketQuota < 1 || slotLength * options->bufferCount > UINT32_MAX) {
+			*error = RIOSOCKETS_ERROR_RIO_BUFFER_SIZE;
+
+			return -1;
+		}
+
+		RioArena* pool = (RioArena*)calloc(1, sizeof(RioArena));
 
-			struct sockaddr_in6* destinationAddress = (struct sockaddr_in6*)(rio->sendMemoryAddress + rio->sendBufferTail * sizeof(SOCKADDR_INET));
+		pool->flags = options->flags;
+		pool->numaNode = (options->flags & RIOSOCKETS_FLAG_NUMA) ? options->numaNode : -1;
+		pool->slotLength = (int)slotLength;
+		pool->slotCount = options->bufferCount;
+		pool->socketQuota = options->socketQuota;
+		pool->links = (uint32_t*)calloc(pool->slotCount, sizeof(uint32_t));
+		pool->memory = riosockets_buffer_allocate(pool->flags, pool->numaNode, slotLength, pool->slotCount);
 
-			*destinationAddress = socketAddress;
+		#ifdef RIOSOCKETS_BACKEND_RIO
+			pool->bufferId = RIO_INVALID_BUFFERID;
+		#endif
 
-			rio->sendBuffers[rio->sendBufferTail].addressless = FALSE;
+		if (pool->memory == NULL) {
+			*error = RIOSOCKETS_ERROR_RIO_BUFFER_CREATION;
+
+			goto destroy;
 		}
 
-		++rio->sendBufferQueue;
-		++rio->sendBufferTail;
+		if (riosockets_backend_register(pool, error) != 0)
+			goto destroy;
 
-		return buffer;
+		for (int i = 0; i < pool->slotCount; i++) {
+			pool->links[i] = (i + 1 < pool->slotCount ? (uint32_t)(i + 1) : RIOSOCKETS_POOL_EMPTY);
+		}
+
+		pool->head = 0;
+		pool->available = pool->slotCount;
+
+		return (RioPool)pool;
+
+		destroy:
+
+		riosockets_pool_destroy((RioPool*)&pool);
+
+		return -1;
 	}
 
-	void riosockets_send(RioSocket socket) {
-		Rio* rio = (Rio*)socket;
+	void riosockets_pool_destroy(RioPool* pool) {
+		RioArena* arena = (RioArena*)*pool;
 
-		if (rio->socket > 0) {
-			while (rio->sendBufferQueue != 0) {
-				int sendBufferHead = rio->sendBufferTail - rio->sendBufferQueue;
-				BOOL addressless = rio->sendBuffers[sendBufferHead].addressless;
+		#ifdef RIOSOCKETS_BACKEND_RIO
+			if (arena->bufferId != RIO_INVALID_BUFFERID)
+				arena->functions.RIODeregisterBuffer(arena->bufferId);
+		#endif
 
-				if (!rio->functions.RIOSendEx(rio->requestQueue, &rio->sendBuffers[sendBufferHead].data, 1, NULL, (addressless == FALSE ? &rio->sendBuffers[sendBufferHead].address : NULL), NULL, NULL, 0, 0)) {
-					RioAddress address = { 0 };
+		riosockets_buffer_free(arena->flags, arena->memory, arena->slotLength, arena->slotCount);
 
-					if (addressless == FALSE)
-						riosockets_address_extract(&address, (struct sockaddr_storage*)(rio->sendMemoryAddress + sendBufferHead * sizeof(SOCKADDR_INET)));
+		free(arena->links);
+		free(arena);
 
-					rio->callback(socket, (addressless == FALSE ? &address : NULL), (const uint8_t*)(rio->sendMemory + sendBufferHead * rio->maxBufferLength), rio->sendBuffers[sendBufferHead].data.Length, RIOSOCKETS_TYPE_SEND);
-				} else {
-					++rio->sendBufferPending;
-				}
+		*pool = 0;
+	}
 
-				--rio->sendBufferQueue;
+	int riosockets_pool_available(RioPool pool) {
+		RioArena* arena = (RioArena*)pool;
+
+		return (int)RIOSOCKETS_ATOMIC_LOAD(&arena->available);
+	}
+
+	#ifndef _WIN32
+		static void* riosockets_shard_poll(void* argument) {
+			RioShard* shard = (RioShard*)argument;
+			RioShards* shards = shard->shards;
+			RioOptions options = shards->options.options;
+			int reusePort = 1;
+
+			if (shards->options.processors != NULL) {
+				cpu_set_t processors;
+
+				CPU_ZERO(&processors);
+				CPU_SET(shards->options.processors[shard->index], &processors);
+
+				pthread_setaffinity_np(pthread_self(), sizeof(processors), &processors);
+			}
+
+			if (shards->options.numaNodes != NULL) {
+				options.flags |= RIOSOCKETS_FLAG_NUMA;
+				options.numaNode = shards->options.numaNodes[shard->index];
+			}
+
+			shard->socket = riosockets_create_ex(&options, &shard->error);
+
+			// The handle is checked as well, a creation that fails before the options are read leaves no error code
+
+			if (shard->socket <= 0) {
+				shard->socket = 0;
+
+				if (shard->error == RIOSOCKETS_ERROR_NONE)
+					shard->error = RIOSOCKETS_ERROR_SOCKET_CREATION;
+			} else if (riosockets_set_option(shard->socket, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) != RIOSOCKETS_STATUS_OK || riosockets_bind(shard->socket, &shards->options.address) != 0) {
+				shard->error = RIOSOCKETS_ERROR_SOCKET_BINDING;
+
+				riosockets_destroy(&shard->socket);
 			}
 
-			int completionCount = rio->functions.RIODequeueCompletion(rio->sendQueue, rio->sendCompletionResults, rio->sendBufferCount);
+			if (shard->error != RIOSOCKETS_ERROR_NONE) {
+				__atomic_store_n(&shard->state, -1, __ATOMIC_RELEASE);
 
-			rio->sendBufferPending -= completionCount;
+				return NULL;
+			}
+
+			__atomic_store_n(&shard->state, 1, __ATOMIC_RELEASE);
+
+			while (__atomic_load_n(&shards->running, __ATOMIC_ACQUIRE)) {
+				riosockets_send(shard->socket);
+
+				if (riosockets_wait(shard->socket, RIOSOCKETS_SHARD_WAIT_TIMEOUT) > 0)
+					riosockets_receive(shard->socket, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+			}
+
+			return NULL;
 		}
-	}
 
-	void riosockets_receive(RioSocket socket, int maxCompletions) {
-		Rio* rio = (Rio*)socket;
+		RioServer riosockets_server_create(const RioServerOptions* options, RioError* error) {
+			if (options == NULL || options->shardCount < 1 || error == NULL)
+				return -1;
 
-		if (rio->socket > 0 && maxCompletions > 0) {
-			if (maxCompletions > RIOSOCKETS_MAX_COMPLETION_RESULTS)
-				maxCompletions = RIOSOCKETS_MAX_COMPLETION_RESULTS;
+			// Shards share the port, so they can't own an inbox each
+
+			if (options->options.flags & RIOSOCKETS_FLAG_SHARED_MEMORY) {
+				*error = RIOSOCKETS_ERROR_OPTIONS;
+
+				return -1;
+			}
 
-			int completionCount = rio->functions.RIODequeueCompletion(rio->receiveQueue, rio->receiveCompletionResults, maxCompletions);
+			RioShards* shards = (RioShards*)calloc(1, sizeof(RioShards));
 
-			if (completionCount > 0) {
-				for (int i = 0; i < completionCount; i++) {
-					RioAddress address = { 0 };
+			shards->options = *options;
+			shards->shards = (RioShard*)calloc(options->shardCount, sizeof(RioShard));
+			shards->running = 1;
 
-					riosockets_address_extract(&address, (struct sockaddr_storage*)(rio->receiveMemoryAddress + rio->receiveBufferHead * sizeof(SOCKADDR_INET)));
+			*error = RIOSOCKETS_ERROR_NONE;
 
-					rio->callback(socket, &address, (const uint8_t*)(rio->receiveMemory + rio->receiveBufferHead * rio->maxBufferLength), rio->receiveCompletionResults[i].BytesTransferred, RIOSOCKETS_TYPE_RECEIVE);
-					rio->functions.RIOReceiveEx(rio->requestQueue, &rio->receiveBuffers[rio->receiveBufferHead].data, 1, NULL, &rio->receiveBuffers[rio->receiveBufferHead].address, NULL, NULL, 0, 0);
+			for (int i = 0; i < options->shardCount; i++) {
+				RioShard* shard = &shards->shards[i];
 
-					++rio->receiveBufferHead;
+				shard->shards = shards;
+				shard->index = i;
 
-					if (rio->receiveBufferHead == rio->receiveBufferCount)
-						rio->receiveBufferHead = 0;
+				if (pthread_create(&shard->thread, NULL, riosockets_shard_poll, shard) != 0) {
+					*error = RIOSOCKETS_ERROR_THREAD_CREATION;
+
+					break;
+				}
+
+				++shards->shardCount;
+
+				while (__atomic_load_n(&shard->state, __ATOMIC_ACQUIRE) == 0) {
+					sched_yield();
+				}
+
+				if (shard->state < 0) {
+					*error = shard->error;
+
+					break;
 				}
+
+				if (i == 0 && shards->options.address.port == 0)
+					riosockets_address_get(shard->socket, &shards->options.address);
+			}
+
+			if (*error != RIOSOCKETS_ERROR_NONE) {
+				RioServer server = (RioServer)shards;
+
+				riosockets_server_destroy(&server);
+
+				return -1;
+			}
+
+			return (RioServer)shards;
+		}
+
+		void riosockets_server_destroy(RioServer* server) {
+			RioShards* shards = (RioShards*)*server;
+
+			__atomic_store_n(&shards->running, 0, __ATOMIC_RELEASE);
+
+			for (int i = 0; i < shards->shardCount; i++) {
+				RioShard* shard = &shards->shards[i];
+
+				pthread_join(shard->thread, NULL);
+
+				if (shard->state > 0)
+					riosockets_destroy(&shard->socket);
 			}
+
+			free(shards->shards);
+			free(shards);
+
+			*server = 0;
 		}
-	}
+
+		RioSocket riosockets_server_socket(RioServer server, int shard) {
+			RioShards* shards = (RioShards*)server;
+
+			if (shard < 0 || shard >= shards->shardCount)
+				return -1;
+
+			return shards->shards[shard].socket;
+		}
+	#endif
 
 	RioStatus riosockets_address_get(RioSocket socket, RioAddress* address) {
 		Rio* rio = (Rio*)socket;
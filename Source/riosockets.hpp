@@ -0,0 +1,764 @@
+/*
+ *  C++20 coroutine interface for RioSockets
+ *  Copyright (c) 2020 Stanislav Denisov
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef RIOSOCKETS_HPP
+#define RIOSOCKETS_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+
+#include "riosockets.h"
+
+#ifndef RIOSOCKETS_FRAME_SIZE
+	#define RIOSOCKETS_FRAME_SIZE 1024
+#endif
+
+namespace riosockets {
+	class Executor;
+	class Socket;
+
+	// Frames of up to RIOSOCKETS_FRAME_SIZE bytes are recycled per thread, larger ones fall back to the global allocator
+
+	class FramePool {
+	public:
+		static void* allocate(std::size_t size) {
+			if (size > RIOSOCKETS_FRAME_SIZE)
+				return ::operator new(size);
+
+			FramePool& pool = instance();
+
+			if (pool.head == nullptr)
+				return ::operator new(RIOSOCKETS_FRAME_SIZE);
+
+			Frame* frame = pool.head;
+
+			pool.head = frame->next;
+
+			return frame;
+		}
+
+		static void deallocate(void* pointer, std::size_t size) noexcept {
+			if (size > RIOSOCKETS_FRAME_SIZE) {
+				::operator delete(pointer);
+
+				return;
+			}
+
+			FramePool& pool = instance();
+			Frame* frame = static_cast<Frame*>(pointer);
+
+			frame->next = pool.head;
+			pool.head = frame;
+		}
+
+	private:
+		struct Frame {
+			Frame* next;
+		};
+
+		Frame* head = nullptr;
+
+		FramePool() = default;
+
+		~FramePool() {
+			while (head != nullptr) {
+				Frame* frame = head;
+
+				head = frame->next;
+
+				::operator delete(frame);
+			}
+		}
+
+		static FramePool& instance() {
+			thread_local FramePool pool;
+
+			return pool;
+		}
+	};
+
+	class Task {
+	public:
+		struct promise_type {
+			Task get_return_object() noexcept {
+				return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept {
+				return { };
+			}
+
+			std::suspend_never final_suspend() noexcept {
+				return { };
+			}
+
+			void return_void() noexcept { }
+
+			void unhandled_exception() noexcept {
+				std::terminate();
+			}
+
+			static void* operator new(std::size_t size) {
+				return FramePool::allocate(size);
+			}
+
+			static void operator delete(void* pointer, std::size_t size) noexcept {
+				FramePool::deallocate(pointer, size);
+			}
+		};
+
+		Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) { }
+
+		Task(const Task&) = delete;
+
+		Task& operator=(const Task&) = delete;
+
+		~Task() {
+			if (handle)
+				handle.destroy();
+		}
+
+	private:
+		friend class Executor;
+
+		std::coroutine_handle<promise_type> handle;
+
+		explicit Task(std::coroutine_handle<promise_type> coroutine) noexcept : handle(coroutine) { }
+	};
+
+	class Message {
+	public:
+		Message() noexcept = default;
+
+		Message(Message&& other) noexcept : socket(std::exchange(other.socket, 0)), message(other.message) { }
+
+		Message& operator=(Message&& other) noexcept {
+			if (this != &other) {
+				release();
+
+				socket = std::exchange(other.socket, 0);
+				message = other.message;
+			}
+
+			return *this;
+		}
+
+		Message(const Message&) = delete;
+
+		Message& operator=(const Message&) = delete;
+
+		~Message() {
+			release();
+		}
+
+		const uint8_t* data() const noexcept {
+			return message.data;
+		}
+
+		int length() const noexcept {
+			return message.dataLength;
+		}
+
+		const RioAddress& address() const noexcept {
+			return message.address;
+		}
+
+		int peer() const noexcept {
+			return message.peer;
+		}
+
+		uint64_t timestamp() const noexcept {
+			return message.timestamp;
+		}
+
+		void release() noexcept {
+			if (socket != 0) {
+				riosockets_release(socket, message.slot);
+
+				socket = 0;
+			}
+		}
+
+	private:
+		friend class Socket;
+
+		RioSocket socket = 0;
+		RioMessage message = { };
+	};
+
+	class Socket {
+	public:
+		// A socket that failed to open completes the awaiters at once, with an empty message or a null buffer
+
+		class ReceiveAwaiter {
+		public:
+			ReceiveAwaiter(const ReceiveAwaiter&) = delete;
+
+			ReceiveAwaiter& operator=(const ReceiveAwaiter&) = delete;
+
+			~ReceiveAwaiter() {
+				if (queued)
+					socket.remove(this);
+			}
+
+			bool await_ready() noexcept {
+				return socket.handle == 0 || (socket.receiveHead == nullptr && socket.take(message));
+			}
+
+			void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+				handle = coroutine;
+
+				socket.enqueue(this);
+			}
+
+			Message await_resume() noexcept {
+				return std::move(message);
+			}
+
+		private:
+			friend class Socket;
+
+			Socket& socket;
+			Message message;
+			std::coroutine_handle<> handle;
+			ReceiveAwaiter* next = nullptr;
+			bool queued = false;
+
+			explicit ReceiveAwaiter(Socket& owner) noexcept : socket(owner) { }
+		};
+
+		class SendAwaiter {
+		public:
+			SendAwaiter(const SendAwaiter&) = delete;
+
+			SendAwaiter& operator=(const SendAwaiter&) = delete;
+
+			~SendAwaiter() {
+				if (queued)
+					socket.remove(this);
+			}
+
+			bool await_ready() noexcept {
+				return socket.handle == 0 || (socket.sendHead == nullptr && (buffer = socket.acquire(this)) != nullptr);
+			}
+
+			void await_suspend(std::coroutine_handle<> coroutine) noexcept {
+				handle = coroutine;
+
+				socket.enqueue(this);
+			}
+
+			uint8_t* await_resume() noexcept {
+				return buffer;
+			}
+
+		private:
+			friend class Socket;
+
+			Socket& socket;
+			RioAddress address;
+			bool addressed;
+			int length;
+			uint8_t* buffer = nullptr;
+			std::coroutine_handle<> handle;
+			SendAwaiter* next = nullptr;
+			bool queued = false;
+
+			SendAwaiter(Socket& owner, const RioAddress* destination, int dataLength) noexcept : socket(owner), address(destination != nullptr ? *destination : RioAddress { }), addressed(destination != nullptr), length(dataLength) { }
+		};
+
+		Socket(Executor& executor, const RioOptions& options, RioError* error) noexcept;
+
+		Socket(const Socket&) = delete;
+
+		Socket& operator=(const Socket&) = delete;
+
+		~Socket();
+
+		explicit operator bool() const noexcept {
+			return handle != 0;
+		}
+
+		RioSocket native() const noexcept {
+			return handle;
+		}
+
+		int bind(const RioAddress& address) noexcept {
+			return riosockets_bind(handle, &address);
+		}
+
+		int connect(const RioAddress& address) noexcept {
+			return riosockets_connect(handle, &address);
+		}
+
+		ReceiveAwaiter receive() noexcept {
+			return ReceiveAwaiter(*this);
+		}
+
+		SendAwaiter send_ready(const RioAddress* address, int length) noexcept {
+			return SendAwaiter(*this, address, length);
+		}
+
+		void flush() noexcept {
+			riosockets_send(handle);
+		}
+
+	private:
+		friend class Executor;
+
+		Executor& executor;
+		RioSocket handle = 0;
+		Socket* previous = nullptr;
+		Socket* next = nullptr;
+		ReceiveAwaiter* receiveHead = nullptr;
+		ReceiveAwaiter* receiveTail = nullptr;
+		int receiveWaiting = 0;
+		SendAwaiter* sendHead = nullptr;
+		SendAwaiter* sendTail = nullptr;
+
+		static void RIOSOCKETS_CALLBACK callback(RioSocket, const RioAddress*, const uint8_t*, int, RioType) { }
+
+		bool take(Message& message) noexcept {
+			if (riosockets_receive_batch(handle, &message.message, 1) != 1)
+				return false;
+
+			message.socket = handle;
+
+			return true;
+		}
+
+		uint8_t* acquire(const SendAwaiter* awaiter) noexcept {
+			return riosockets_buffer(handle, (awaiter->addressed ? &awaiter->address : nullptr), awaiter->length);
+		}
+
+		void enqueue(ReceiveAwaiter* awaiter) noexcept {
+			if (receiveTail == nullptr)
+				receiveHead = awaiter;
+			else
+				receiveTail->next = awaiter;
+
+			receiveTail = awaiter;
+			awaiter->queued = true;
+
+			++receiveWaiting;
+		}
+
+		void enqueue(SendAwaiter* awaiter) noexcept {
+			if (sendTail == nullptr)
+				sendHead = awaiter;
+			else
+				sendTail->next = awaiter;
+
+			sendTail = awaiter;
+			awaiter->queued = true;
+		}
+
+		ReceiveAwaiter* dequeue() noexcept {
+			ReceiveAwaiter* awaiter = receiveHead;
+
+			receiveHead = awaiter->next;
+
+			if (receiveHead == nullptr)
+				receiveTail = nullptr;
+
+			awaiter->queued = false;
+
+			--receiveWaiting;
+
+			return awaiter;
+		}
+
+		SendAwaiter* dequeueSend() noexcept {
+			SendAwaiter* awaiter = sendHead;
+
+			sendHead = awaiter->next;
+
+			if (sendHead == nullptr)
+				sendTail = nullptr;
+
+			awaiter->queued = false;
+
+			return awaiter;
+		}
+
+		// Unlinks an awaiter whose coroutine was destroyed while it was suspended
+
+		void remove(ReceiveAwaiter* awaiter) noexcept {
+			ReceiveAwaiter* previousAwaiter = nullptr;
+
+			for (ReceiveAwaiter* current = receiveHead; current != nullptr; previousAwaiter = current, current = current->next) {
+				if (current != awaiter)
+					continue;
+
+				if (previousAwaiter == nullptr)
+					receiveHead = current->next;
+				else
+					previousAwaiter->next = current->next;
+
+				if (receiveTail == current)
+					receiveTail = previousAwaiter;
+
+				--receiveWaiting;
+
+				break;
+			}
+
+			awaiter->queued = false;
+		}
+
+		void remove(SendAwaiter* awaiter) noexcept {
+			SendAwaiter* previousAwaiter = nullptr;
+
+			for (SendAwaiter* current = sendHead; current != nullptr; previousAwaiter = current, current = current->next) {
+				if (current != awaiter)
+					continue;
+
+				if (previousAwaiter == nullptr)
+					sendHead = current->next;
+				else
+					previousAwaiter->next = current->next;
+
+				if (sendTail == current)
+					sendTail = previousAwaiter;
+
+				break;
+			}
+
+			awaiter->queued = false;
+		}
+
+		bool process(RioMessage* messages) noexcept;
+	};
+
+	class Executor {
+	public:
+		Executor() noexcept = default;
+
+		Executor(const Executor&) = delete;
+
+		Executor& operator=(const Executor&) = delete;
+
+		void spawn(Task task) noexcept {
+			std::exchange(task.handle, nullptr).resume();
+		}
+
+		// Flushes and receives on every socket once, resuming waiting coroutines from the completion batches
+
+		bool poll() noexcept {
+			bool progressed = false;
+
+			for (Socket* socket = sockets; socket != nullptr; socket = socket->next) {
+				progressed |= socket->process(messages);
+			}
+
+			return progressed;
+		}
+
+		// Blocks until a socket with waiting coroutines has messages or completed sends, without any waiter or beyond RIOSOCKETS_MAX_WAIT_SOCKETS sockets the wait is limited to a millisecond
+
+		int wait(int timeout) noexcept {
+			RioSocket handles[RIOSOCKETS_MAX_WAIT_SOCKETS];
+			int handleCount = 0;
+
+			for (Socket* socket = sockets; socket != nullptr; socket = socket->next) {
+				if (socket->receiveHead == nullptr && socket->sendHead == nullptr)
+					continue;
+
+				if (handleCount == RIOSOCKETS_MAX_WAIT_SOCKETS) {
+					if (timeout < 0 || timeout > 1)
+						timeout = 1;
+
+					break;
+				}
+
+				handles[handleCount++] = socket->handle;
+			}
+
+			if (handleCount == 0) {
+				if (sockets == nullptr)
+					return 0;
+
+				handles[handleCount++] = sockets->handle;
+
+				if (timeout < 0 || timeout > 1)
+					timeout = 1;
+			}
+
+			return riosockets_wait_any(handles, handleCount, timeout);
+		}
+
+		// Runs until stopped or no socket is left, and sleeps whenever a poll resumed no coroutine
+
+		void run() noexcept {
+			stopped = false;
+
+			while (!stopped && sockets != nullptr) {
+				if (!poll())
+					wait(-1);
+			}
+		}
+
+		void stop() noexcept {
+			stopped = true;
+		}
+
+	private:
+		friend class Socket;
+
+		Socket* sockets = nullptr;
+		bool stopped = false;
+		RioMessage messages[RIOSOCKETS_MAX_COMPLETION_RESULTS];
+	};
+
+	inline Socket::Socket(Executor& owner, const RioOptions& options, RioError* error) noexcept : executor(owner) {
+		RioOptions socketOptions = options;
+
+		if (socketOptions.callback == nullptr)
+			socketOptions.callback = callback;
+
+		handle = riosockets_create_ex(&socketOptions, error);
+
+		if (handle <= 0) {
+			handle = 0;
+
+			return;
+		}
+
+		next = executor.sockets;
+
+		if (next != nullptr)
+			next->previous = this;
+
+		executor.sockets = this;
+	}
+
+	// Coroutines still waiting on the socket are cancelled, their frames are destroyed while the handle is open so that held messages are released
+
+	inline Socket::~Socket() {
+		if (handle == 0)
+			return;
+
+		if (previous != nullptr)
+			previous->next = next;
+		else
+			executor.sockets = next;
+
+		if (next != nullptr)
+			next->previous = previous;
+
+		while (receiveHead != nullptr) {
+			dequeue()->handle.destroy();
+		}
+
+		while (sendHead != nullptr) {
+			dequeueSend()->handle.destroy();
+		}
+
+		riosockets_destroy(&handle);
+	}
+
+	inline bool Socket::process(RioMessage* messages) noexcept {
+		bool progressed = false;
+
+		riosockets_send(handle);
+
+		while (sendHead != nullptr) {
+			uint8_t* buffer = acquire(sendHead);
+
+			if (buffer == nullptr)
+				break;
+
+			SendAwaiter* awaiter = dequeueSend();
+
+			awaiter->buffer = buffer;
+			awaiter->handle.resume();
+
+			progressed = true;
+		}
+
+		// Only as many messages as there are waiters are taken, the rest stay in the ring for the next poll
+
+		while (receiveHead != nullptr) {
+			int messageCount = riosockets_receive_batch(handle, messages, (receiveWaiting < RIOSOCKETS_MAX_COMPLETION_RESULTS ? receiveWaiting : RIOSOCKETS_MAX_COMPLETION_RESULTS));
+
+			if (messageCount <= 0)
+				break;
+
+			for (int i = 0; i < messageCount; i++) {
+				ReceiveAwaiter* awaiter = dequeue();
+
+				awaiter->message.socket = handle;
+				awaiter->message.message = messages[i];
+				awaiter->handle.resume();
+			}
+
+			progressed = true;
+		}
+
+		return progressed;
+	}
+
+	// Compile-time options of SocketT, derive from it and override the members to change them
+
+	struct SocketTraits {
+		static constexpr bool addressless = false;
+		static constexpr int messageLength = 0;
+		static constexpr int maxCompletions = RIOSOCKETS_MAX_COMPLETION_RESULTS;
+		static constexpr bool stats = true;
+		static constexpr bool peers = true;
+		static constexpr bool coalescing = true;
+		static constexpr bool bundle = true;
+		static constexpr bool sharedMemory = true;
+	};
+
+	// A typed wrapper that receives through a batch and invokes the handler directly instead of through the callback pointer, the library runs a receive loop specialized for the features enabled in the traits
+
+	template <typename Handler, typename Traits = SocketTraits>
+	class SocketT {
+		static_assert(Traits::messageLength >= 0, "Message length can't be negative");
+		static_assert(Traits::maxCompletions > 0 && Traits::maxCompletions <= RIOSOCKETS_MAX_COMPLETION_RESULTS, "Max completions is out of range");
+
+	public:
+		static constexpr int features = (Traits::stats ? RIOSOCKETS_FEATURE_STATS : 0) | (Traits::peers ? RIOSOCKETS_FEATURE_PEERS : 0) | (Traits::coalescing ? RIOSOCKETS_FEATURE_COALESCING : 0) | (Traits::bundle ? RIOSOCKETS_FEATURE_BUNDLE : 0) | (Traits::sharedMemory ? RIOSOCKETS_FEATURE_SHARED_MEMORY : 0);
+
+		// Options that need a feature the traits leave out are rejected
+
+		SocketT(const RioOptions& options, RioError* error, Handler handler = Handler()) noexcept : socketHandler(std::move(handler)) {
+			RioOptions socketOptions = options;
+
+			if ((!Traits::peers && options.maxPeers > 0) || (!Traits::coalescing && (options.flags & (RIOSOCKETS_FLAG_GSO | RIOSOCKETS_FLAG_GRO))) || (!Traits::bundle && (options.flags & RIOSOCKETS_FLAG_BUNDLE)) || (!Traits::sharedMemory && (options.flags & RIOSOCKETS_FLAG_SHARED_MEMORY))) {
+				if (error != nullptr)
+					*error = RIOSOCKETS_ERROR_OPTIONS;
+
+				return;
+			}
+
+			if (socketOptions.callback == nullptr)
+				socketOptions.callback = callback;
+
+			if constexpr (Traits::messageLength > 0) {
+				if (socketOptions.maxBufferLength < Traits::messageLength)
+					socketOptions.maxBufferLength = Traits::messageLength;
+			}
+
+			handle = riosockets_create_ex(&socketOptions, error);
+
+			if (handle <= 0)
+				handle = 0;
+		}
+
+		SocketT(const SocketT&) = delete;
+
+		SocketT& operator=(const SocketT&) = delete;
+
+		~SocketT() {
+			if (handle != 0)
+				riosockets_destroy(&handle);
+		}
+
+		explicit operator bool() const noexcept {
+			return handle != 0;
+		}
+
+		RioSocket native() const noexcept {
+			return handle;
+		}
+
+		Handler& handler() noexcept {
+			return socketHandler;
+		}
+
+		uint64_t mismatchedMessages() const noexcept {
+			return mismatches;
+		}
+
+		int bind(const RioAddress& address) noexcept {
+			return riosockets_bind(handle, &address);
+		}
+
+		int connect(const RioAddress& address) noexcept {
+			return riosockets_connect(handle, &address);
+		}
+
+		uint8_t* buffer(const RioAddress& address, int dataLength) noexcept requires (!Traits::addressless && Traits::messageLength == 0) {
+			return riosockets_buffer_ex(handle, &address, dataLength, features);
+		}
+
+		uint8_t* buffer(const RioAddress& address) noexcept requires (!Traits::addressless && Traits::messageLength > 0) {
+			return riosockets_buffer_ex(handle, &address, Traits::messageLength, features);
+		}
+
+		uint8_t* buffer(int dataLength) noexcept requires (Traits::addressless && Traits::messageLength == 0) {
+			return riosockets_buffer_ex(handle, nullptr, dataLength, features);
+		}
+
+		uint8_t* buffer() noexcept requires (Traits::addressless && Traits::messageLength > 0) {
+			return riosockets_buffer_ex(handle, nullptr, Traits::messageLength, features);
+		}
+
+		void send() noexcept {
+			riosockets_send(handle);
+		}
+
+		// Messages of another length are counted and passed to the mismatch member of the handler if it has one when the length is fixed, all messages are released after the handler returns
+
+		int receive() noexcept {
+			RioMessage messages[Traits::maxCompletions];
+			int messageCount = riosockets_receive_batch_ex(handle, messages, Traits::maxCompletions, features);
+
+			if (messageCount <= 0)
+				return 0;
+
+			for (int i = 0; i < messageCount; i++) {
+				if constexpr (Traits::messageLength > 0) {
+					if (messages[i].dataLength != Traits::messageLength) {
+						++mismatches;
+
+						if constexpr (requires { socketHandler.mismatch(*this, messages[i]); })
+							socketHandler.mismatch(*this, messages[i]);
+
+						continue;
+					}
+				}
+
+				socketHandler(*this, messages[i]);
+			}
+
+			riosockets_release_batch(handle, messages, messageCount);
+
+			return messageCount;
+		}
+
+	private:
+		RioSocket handle = 0;
+		Handler socketHandler;
+		uint64_t mismatches = 0;
+
+		static void RIOSOCKETS_CALLBACK callback(RioSocket, const RioAddress*, const uint8_t*, int, RioType) { }
+	};
+}
+
+#endif // RIOSOCKETS_HPP
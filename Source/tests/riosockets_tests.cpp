@@ -0,0 +1,2019 @@
+/*
+ *  Tests for RioSockets
+ *  Copyright (c) 2020 Stanislav Denisov
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../riosockets.hpp"
+
+#ifndef _WIN32
+	#include <dirent.h>
+#endif
+
+#define TEST_ROUNDS 2000
+
+static int failures;
+
+#define TEST_CHECK(condition) do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); ++failures; } } while (0)
+
+static void RIOSOCKETS_CALLBACK test_callback(RioSocket, const RioAddress*, const uint8_t*, int, RioType) { }
+
+static RioOptions test_options(int maxBufferLength, int bufferSize) {
+	RioOptions options = { };
+
+	options.maxBufferLength = maxBufferLength;
+	options.sendBufferSize = bufferSize;
+	options.receiveBufferSize = bufferSize;
+	options.callback = test_callback;
+
+	return options;
+}
+
+// Creates a socket bound to an ephemeral port on the loopback and reports the address of it
+
+static RioSocket test_socket(const RioOptions& options, RioAddress* address) {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioSocket socket = riosockets_create_ex(&options, &error);
+
+	TEST_CHECK(socket > 0);
+
+	if (socket <= 0)
+		return 0;
+
+	RioAddress bindAddress = { };
+
+	riosockets_address_set_ip(&bindAddress, "::1");
+
+	if (riosockets_bind(socket, &bindAddress) != 0 || riosockets_address_get(socket, address) != RIOSOCKETS_STATUS_OK) {
+		TEST_CHECK(false);
+
+		riosockets_destroy(&socket);
+
+		return 0;
+	}
+
+	return socket;
+}
+
+// Flushes the sender and collects messages until the expected number arrived or the rounds ran out, the caller releases them
+
+static int test_receive(RioSocket receiver, RioSocket sender, RioMessage* messages, int expected, int rounds = TEST_ROUNDS) {
+	int messageCount = 0;
+
+	for (int i = 0; i < rounds && messageCount < expected; i++) {
+		if (sender != 0)
+			riosockets_send(sender);
+
+		int received = riosockets_receive_batch(receiver, messages + messageCount, expected - messageCount);
+
+		if (received > 0)
+			messageCount += received;
+		else
+			riosockets_wait(receiver, 1);
+	}
+
+	return messageCount;
+}
+
+inline static void test_fill(uint8_t* data, int dataLength, int seed) {
+	for (int i = 0; i < dataLength; i++) {
+		data[i] = (uint8_t)(seed + i);
+	}
+}
+
+inline static bool test_verify(const uint8_t* data, int dataLength, int seed) {
+	for (int i = 0; i < dataLength; i++) {
+		if (data[i] != (uint8_t)(seed + i))
+			return false;
+	}
+
+	return true;
+}
+
+// Messages of different lengths arrive intact and in order with the address of the sender
+
+static void test_round_trip() {
+	RioOptions options = test_options(1024, 256 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[32];
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 32; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, i * 32 + 1);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, i * 32 + 1, i);
+		}
+
+		int messageCount = test_receive(server, client, messages, 32);
+
+		TEST_CHECK(messageCount == 32);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength == i * 32 + 1);
+			TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, i));
+			TEST_CHECK(messages[i].address.port == clientAddress.port);
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		// A reply uses the address the message arrived from
+
+		uint8_t* buffer = riosockets_buffer(server, &clientAddress, 8);
+
+		TEST_CHECK(buffer != nullptr);
+
+		if (buffer != nullptr)
+			test_fill(buffer, 8, 7);
+
+		messageCount = test_receive(client, server, messages, 1);
+
+		TEST_CHECK(messageCount == 1);
+		TEST_CHECK(messageCount == 1 && test_verify(messages[0].data, 8, 7));
+
+		riosockets_release_batch(client, messages, messageCount);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Many times the capacity of both rings passes through them, so the send memory and the receive buffers wrap around
+
+static void test_ring_wrap() {
+	RioOptions options = test_options(512, 16 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[8];
+	int sequence = 0;
+
+	if (server != 0 && client != 0) {
+		for (int round = 0; round < 200; round++) {
+			for (int i = 0; i < 8; i++) {
+				int dataLength = 200 + (round * 8 + i) % 300;
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, dataLength);
+
+				TEST_CHECK(buffer != nullptr);
+
+				if (buffer != nullptr)
+					test_fill(buffer, dataLength, round * 8 + i);
+			}
+
+			int messageCount = test_receive(server, client, messages, 8);
+
+			TEST_CHECK(messageCount == 8);
+
+			for (int i = 0; i < messageCount; i++, sequence++) {
+				TEST_CHECK(messages[i].dataLength == 200 + sequence % 300);
+				TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, sequence));
+			}
+
+			riosockets_release_batch(server, messages, messageCount);
+
+			if (messageCount != 8)
+				break;
+		}
+
+		TEST_CHECK(sequence == 200 * 8);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// A flush larger than a single completion batch is sent and received in full and in order
+
+static void test_send_batch() {
+	RioOptions options = test_options(64, 256 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[160];
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 160; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 32);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 32, i);
+		}
+
+		riosockets_send(client);
+
+		int messageCount = test_receive(server, 0, messages, 160);
+
+		TEST_CHECK(messageCount == 160);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength == 32 && test_verify(messages[i].data, 32, i));
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Options that can't work are rejected with an error code instead of a handle
+
+static void test_create_options() {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = test_options(1024, 65536);
+
+	options.callback = nullptr;
+
+	TEST_CHECK(riosockets_create_ex(&options, &error) <= 0);
+	TEST_CHECK(error == RIOSOCKETS_ERROR_OPTIONS);
+
+	options.callback = test_callback;
+	options.flags = RIOSOCKETS_FLAG_SHARED_MEMORY | RIOSOCKETS_FLAG_CONCURRENT_SEND;
+	error = RIOSOCKETS_ERROR_NONE;
+
+	TEST_CHECK(riosockets_create_ex(&options, &error) <= 0);
+	TEST_CHECK(error == RIOSOCKETS_ERROR_OPTIONS);
+}
+
+// A run of same-length messages for one receiver goes out as a segmented datagram and still arrives as separate messages, the shorter last one included
+
+static void test_gso_coalescing() {
+	RioOptions options = test_options(1024, 256 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.flags = RIOSOCKETS_FLAG_GSO;
+
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[17];
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 17; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, (i < 16 ? 100 : 40));
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, (i < 16 ? 100 : 40), i);
+		}
+
+		riosockets_send(client);
+
+		int messageCount = test_receive(server, 0, messages, 17);
+
+		TEST_CHECK(messageCount == 17);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength == (i < 16 ? 100 : 40));
+			TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, i));
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		#if !defined(_WIN32) && !defined(RIOSOCKETS_NO_STATS)
+			RioStats stats = { };
+
+			TEST_CHECK(riosockets_get_stats(client, &stats) == RIOSOCKETS_STATUS_OK);
+			TEST_CHECK(stats.coalescedBatches >= 1);
+			TEST_CHECK(stats.coalescedMessages == 17);
+		#endif
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+static int groReceived;
+static int groMismatched;
+
+static void RIOSOCKETS_CALLBACK test_gro_callback(RioSocket, const RioAddress*, const uint8_t* data, int dataLength, RioType type) {
+	if (type != RIOSOCKETS_TYPE_RECEIVE)
+		return;
+
+	if (dataLength != (groReceived < 16 ? 100 : 40) || !test_verify(data, dataLength, groReceived))
+		++groMismatched;
+
+	++groReceived;
+}
+
+// A segmented train that the kernel coalesced into one receive buffer is split back at the segment boundaries, for the batch and for the callback
+
+static void test_gro_splitting() {
+	RioOptions options = test_options(1024, 1024 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+
+	options.flags = RIOSOCKETS_FLAG_GRO;
+	options.callback = test_gro_callback;
+
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.flags = RIOSOCKETS_FLAG_GSO;
+	options.callback = test_callback;
+
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[17];
+
+	if (server != 0 && client != 0) {
+		for (int round = 0; round < 2; round++) {
+			for (int i = 0; i < 17; i++) {
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, (i < 16 ? 100 : 40));
+
+				TEST_CHECK(buffer != nullptr);
+
+				if (buffer != nullptr)
+					test_fill(buffer, (i < 16 ? 100 : 40), i);
+			}
+
+			riosockets_send(client);
+
+			if (round == 0) {
+				int messageCount = test_receive(server, 0, messages, 17);
+
+				TEST_CHECK(messageCount == 17);
+
+				for (int i = 0; i < messageCount; i++) {
+					TEST_CHECK(messages[i].dataLength == (i < 16 ? 100 : 40));
+					TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, i));
+					TEST_CHECK(messages[i].address.port == clientAddress.port);
+				}
+
+				riosockets_release_batch(server, messages, messageCount);
+			} else {
+				for (int i = 0; i < TEST_ROUNDS && groReceived < 17; i++) {
+					if (riosockets_wait(server, 1) > 0)
+						riosockets_receive(server, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+				}
+
+				TEST_CHECK(groReceived == 17);
+				TEST_CHECK(groMismatched == 0);
+			}
+		}
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// A batch never exceeds the requested number of messages, the rest stays queued for the next call in order
+
+static void test_batch_limit() {
+	RioOptions options = test_options(64, 64 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[20];
+	int messageCount = 0;
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 20; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 16);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 16, i);
+		}
+
+		riosockets_send(client);
+
+		for (int i = 0; i < TEST_ROUNDS && messageCount < 20; i++) {
+			int received = riosockets_receive_batch(server, messages + messageCount, 5);
+
+			TEST_CHECK(received <= 5);
+
+			if (received > 0)
+				messageCount += received;
+			else
+				riosockets_wait(server, 1);
+		}
+
+		TEST_CHECK(messageCount == 20);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(test_verify(messages[i].data, 16, i));
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Held batch messages keep their payloads while later messages pass through the remaining buffers, a socket that holds all of them stops receiving until they are released
+
+static void test_batch_release() {
+	RioOptions options = test_options(256, 256 * 8);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage held[4];
+	RioMessage messages[64];
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 4; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 64);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 64, 100 + i);
+		}
+
+		TEST_CHECK(test_receive(server, client, held, 4) == 4);
+
+		for (int round = 0; round < 16; round++) {
+			for (int i = 0; i < 2; i++) {
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, 64);
+
+				if (buffer != nullptr)
+					test_fill(buffer, 64, round);
+			}
+
+			int messageCount = test_receive(server, client, messages, 2);
+
+			TEST_CHECK(messageCount == 2);
+
+			for (int i = 0; i < messageCount; i++) {
+				TEST_CHECK(test_verify(messages[i].data, 64, round));
+			}
+
+			riosockets_release_batch(server, messages, messageCount);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			TEST_CHECK(test_verify(held[i].data, 64, 100 + i));
+		}
+
+		riosockets_release_batch(server, held, 4);
+
+		// Holding every buffer stops the socket, releasing them lets the queued messages in
+
+		int heldCount = 0;
+
+		for (int round = 0; round < 64 && heldCount < 64; round++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 64);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 64, round);
+
+			int received = test_receive(server, client, messages + heldCount, 1, 50);
+
+			if (received == 0)
+				break;
+
+			heldCount += received;
+		}
+
+		TEST_CHECK(heldCount > 0 && heldCount < 64);
+
+		riosockets_release_batch(server, messages, heldCount);
+
+		int messageCount = test_receive(server, client, messages, 1);
+
+		TEST_CHECK(messageCount == 1);
+		TEST_CHECK(messageCount == 1 && test_verify(messages[0].data, 64, heldCount));
+
+		riosockets_release_batch(server, messages, messageCount);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+static int retainedSlots[4];
+static const uint8_t* retainedData[4];
+static int retainedCount;
+
+static void RIOSOCKETS_CALLBACK test_retain_callback(RioSocket socket, const RioAddress*, const uint8_t* data, int, RioType type) {
+	if (type != RIOSOCKETS_TYPE_RECEIVE || retainedCount == 4)
+		return;
+
+	retainedSlots[retainedCount] = riosockets_retain(socket);
+	retainedData[retainedCount++] = data;
+}
+
+// Payloads retained within the callback stay intact after it returns while later messages reuse the other buffers
+
+static void test_callback_retain() {
+	RioOptions options = test_options(256, 256 * 8);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+
+	options.callback = test_retain_callback;
+
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.callback = test_callback;
+
+	RioSocket client = test_socket(options, &clientAddress);
+
+	if (server != 0 && client != 0) {
+		for (int round = 0; round < 20; round++) {
+			for (int i = 0; i < 2; i++) {
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, 64);
+
+				if (buffer != nullptr)
+					test_fill(buffer, 64, round * 2 + i);
+			}
+
+			riosockets_send(client);
+
+			for (int i = 0; i < TEST_ROUNDS; i++) {
+				riosockets_send(client);
+
+				if (riosockets_wait(server, 1) > 0) {
+					riosockets_receive(server, RIOSOCKETS_MAX_COMPLETION_RESULTS);
+
+					break;
+				}
+			}
+		}
+
+		TEST_CHECK(retainedCount == 4);
+
+		for (int i = 0; i < retainedCount; i++) {
+			TEST_CHECK(retainedSlots[i] >= 0);
+			TEST_CHECK(test_verify(retainedData[i], 64, i));
+
+			riosockets_release(server, retainedSlots[i]);
+		}
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Small messages take only their length from the send ring, and lengths that don't divide the ring make the allocations wrap at arbitrary offsets
+
+static void test_packed_wrap() {
+	RioOptions options = test_options(1024, 4096);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+
+	options.receiveBufferSize = 256 * 1024;
+
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[64];
+
+	if (server != 0 && client != 0) {
+		int acquired = 0;
+
+		while (acquired < 64) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 16);
+
+			if (buffer == nullptr)
+				break;
+
+			test_fill(buffer, 16, acquired++);
+		}
+
+		TEST_CHECK(acquired > 4096 / 1024);
+
+		int messageCount = test_receive(server, client, messages, acquired);
+
+		TEST_CHECK(messageCount == acquired);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(test_verify(messages[i].data, 16, i));
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		int lengths[] = { 700, 300, 1000, 13, 517 };
+		int sequence = 0;
+
+		for (int round = 0; round < 100; round++) {
+			int queued = 0;
+
+			for (int i = 0; i < 3; i++) {
+				int dataLength = lengths[(round * 3 + i) % 5];
+				uint8_t* buffer = nullptr;
+
+				for (int j = 0; j < TEST_ROUNDS && buffer == nullptr; j++) {
+					buffer = riosockets_buffer(client, &serverAddress, dataLength);
+
+					if (buffer == nullptr)
+						riosockets_send(client);
+				}
+
+				TEST_CHECK(buffer != nullptr);
+
+				if (buffer == nullptr)
+					break;
+
+				test_fill(buffer, dataLength, round * 3 + i);
+
+				++queued;
+			}
+
+			messageCount = test_receive(server, client, messages, queued);
+
+			TEST_CHECK(messageCount == queued);
+
+			for (int i = 0; i < messageCount; i++, sequence++) {
+				TEST_CHECK(messages[i].dataLength == lengths[sequence % 5]);
+				TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, sequence));
+			}
+
+			riosockets_release_batch(server, messages, messageCount);
+		}
+
+		TEST_CHECK(sequence == 300);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Producers reserve and publish concurrently while the main thread drains, every message of each producer arrives once and in the order it was reserved
+
+static void test_concurrent_send() {
+	constexpr int producerCount = 4;
+	constexpr int producerMessages = 2000;
+
+	RioOptions options = test_options(128, 1024 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.sendBufferSize = 8 * 1024;
+	options.flags = RIOSOCKETS_FLAG_CONCURRENT_SEND;
+
+	RioSocket client = test_socket(options, &clientAddress);
+
+	if (server != 0 && client != 0) {
+		TEST_CHECK(riosockets_buffer(client, &serverAddress, 16) == nullptr);
+
+		std::atomic<bool> stopped(false);
+		std::thread producers[producerCount];
+		int expected[producerCount] = { };
+		int received = 0;
+		int invalid = 0;
+
+		for (int producer = 0; producer < producerCount; producer++) {
+			producers[producer] = std::thread([&, producer]() {
+				for (int sequence = 0; sequence < producerMessages && !stopped.load(); ) {
+					int dataLength = 8 + (sequence * 7 + producer) % 90;
+					int slot = -1;
+					uint8_t* buffer = riosockets_buffer_reserve(client, &serverAddress, dataLength, &slot);
+
+					if (buffer == nullptr) {
+						std::this_thread::yield();
+
+						continue;
+					}
+
+					buffer[0] = (uint8_t)producer;
+					memcpy(buffer + 1, &sequence, sizeof(int));
+					test_fill(buffer + 5, dataLength - 5, sequence);
+					riosockets_buffer_publish(client, slot);
+
+					++sequence;
+				}
+			});
+		}
+
+		RioMessage messages[64];
+
+		for (int i = 0; i < TEST_ROUNDS * 100 && received < producerCount * producerMessages; i++) {
+			riosockets_send(client);
+
+			int messageCount = riosockets_receive_batch(server, messages, 64);
+
+			for (int j = 0; j < messageCount; j++) {
+				int producer = messages[j].data[0];
+				int sequence = 0;
+
+				memcpy(&sequence, messages[j].data + 1, sizeof(int));
+
+				if (producer >= producerCount || sequence != expected[producer] || messages[j].dataLength != 8 + (sequence * 7 + producer) % 90 || !test_verify(messages[j].data + 5, messages[j].dataLength - 5, sequence))
+					++invalid;
+				else
+					++expected[producer];
+
+				++received;
+			}
+
+			if (messageCount > 0)
+				riosockets_release_batch(server, messages, messageCount);
+			else
+				std::this_thread::yield();
+		}
+
+		stopped.store(true);
+
+		for (std::thread& producer : producers) {
+			producer.join();
+		}
+
+		TEST_CHECK(received == producerCount * producerMessages);
+		TEST_CHECK(invalid == 0);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// A pooled socket can't hold more than its quota, and every buffer returns to the pool on send completion, release and destruction
+
+static void test_pool_quota() {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioPoolOptions poolOptions = { };
+
+	poolOptions.maxBufferLength = 1024;
+	poolOptions.bufferCount = 64;
+	poolOptions.socketQuota = 16;
+
+	RioPool pool = riosockets_pool_create(&poolOptions, &error);
+
+	TEST_CHECK(pool > 0);
+
+	if (pool <= 0)
+		return;
+
+	TEST_CHECK(riosockets_pool_available(pool) == 64);
+
+	RioOptions options = test_options(2048, 0);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+
+	options.pool = pool;
+
+	TEST_CHECK(riosockets_create_ex(&options, &error) <= 0);
+	TEST_CHECK(error == RIOSOCKETS_ERROR_POOL);
+
+	options.maxBufferLength = 1024;
+
+	RioSocket server = test_socket(options, &serverAddress);
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[16];
+
+	if (server != 0 && client != 0) {
+		int idle = riosockets_pool_available(pool);
+		int acquired = 0;
+
+		TEST_CHECK(idle < 64);
+
+		while (acquired < 32) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 100);
+
+			if (buffer == nullptr)
+				break;
+
+			test_fill(buffer, 100, acquired++);
+		}
+
+		TEST_CHECK(acquired > 0 && acquired < 16);
+
+		int messageCount = test_receive(server, client, messages, acquired);
+
+		TEST_CHECK(messageCount == acquired);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(test_verify(messages[i].data, 100, i));
+		}
+
+		riosockets_send(client);
+
+		TEST_CHECK(riosockets_pool_available(pool) < idle);
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		// Send completions are reaped by the next flush, the receive side posts a few buffers back once it's polled again
+
+		for (int i = 0; i < TEST_ROUNDS && riosockets_pool_available(pool) < idle; i++) {
+			riosockets_send(client);
+			riosockets_receive_batch(server, messages, 0);
+		}
+
+		TEST_CHECK(riosockets_pool_available(pool) >= idle);
+		TEST_CHECK(riosockets_buffer(client, &serverAddress, 100) != nullptr);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+
+	TEST_CHECK(riosockets_pool_available(pool) == 64);
+
+	riosockets_pool_destroy(&pool);
+}
+
+// Sends a single message and reports the peer that the receiver tagged it with, or a value below -1 if it didn't arrive
+
+static int test_peer_of(RioSocket receiver, RioSocket sender, const RioAddress& address) {
+	RioMessage message;
+	uint8_t* buffer = riosockets_buffer(sender, &address, 8);
+
+	if (buffer == nullptr)
+		return -2;
+
+	test_fill(buffer, 8, 0);
+
+	if (test_receive(receiver, sender, &message, 1) != 1)
+		return -2;
+
+	int peer = message.peer;
+
+	riosockets_release_batch(receiver, &message, 1);
+
+	return peer;
+}
+
+// Only registered senders are tagged, the registry is bounded and removed identifiers are reused
+
+static void test_peer_registry() {
+	RioOptions options = test_options(256, 64 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddresses[3] = { };
+	RioSocket clients[3] = { };
+
+	options.maxPeers = 2;
+
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.maxPeers = 0;
+
+	for (int i = 0; i < 3; i++) {
+		clients[i] = test_socket(options, &clientAddresses[i]);
+	}
+
+	if (server != 0 && clients[0] != 0 && clients[1] != 0 && clients[2] != 0) {
+		TEST_CHECK(test_peer_of(server, clients[0], serverAddress) == -1);
+
+		int first = riosockets_peer_register(server, &clientAddresses[0]);
+		int second = riosockets_peer_register(server, &clientAddresses[1]);
+
+		TEST_CHECK(first >= 0 && second >= 0 && first != second);
+		TEST_CHECK(riosockets_peer_register(server, &clientAddresses[0]) == first);
+		TEST_CHECK(riosockets_peer_register(server, &clientAddresses[2]) < 0);
+
+		TEST_CHECK(test_peer_of(server, clients[0], serverAddress) == first);
+		TEST_CHECK(test_peer_of(server, clients[1], serverAddress) == second);
+		TEST_CHECK(test_peer_of(server, clients[2], serverAddress) == -1);
+
+		RioAddress peerAddress = { };
+
+		TEST_CHECK(riosockets_peer_address(server, second, &peerAddress) == RIOSOCKETS_STATUS_OK);
+		TEST_CHECK(riosockets_address_is_equal(&peerAddress, &clientAddresses[1]) == RIOSOCKETS_STATUS_OK);
+
+		uint8_t* buffer = riosockets_buffer_peer(server, second, 8);
+
+		TEST_CHECK(buffer != nullptr);
+
+		if (buffer != nullptr) {
+			RioMessage message;
+
+			test_fill(buffer, 8, 3);
+
+			TEST_CHECK(test_receive(clients[1], server, &message, 1) == 1);
+			TEST_CHECK(test_verify(message.data, 8, 3));
+
+			riosockets_release_batch(clients[1], &message, 1);
+		}
+
+		riosockets_peer_remove(server, first);
+
+		TEST_CHECK(test_peer_of(server, clients[0], serverAddress) == -1);
+		TEST_CHECK(riosockets_buffer_peer(server, first, 8) == nullptr);
+		TEST_CHECK(riosockets_peer_register(server, &clientAddresses[2]) == first);
+		TEST_CHECK(test_peer_of(server, clients[2], serverAddress) == first);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	for (RioSocket& client : clients) {
+		if (client != 0)
+			riosockets_destroy(&client);
+	}
+}
+
+// The shared payload of a fan-out stays in place until the last of its sends completed, so a small ring cycled many times never delivers a newer payload for an older one
+
+static void test_fanout_lifetime() {
+	RioOptions options = test_options(512, 64 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddresses[3] = { };
+	RioSocket clients[3] = { };
+
+	options.sendBufferSize = 4096;
+
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.sendBufferSize = 64 * 1024;
+
+	for (int i = 0; i < 3; i++) {
+		clients[i] = test_socket(options, &clientAddresses[i]);
+	}
+
+	if (server != 0 && clients[0] != 0 && clients[1] != 0 && clients[2] != 0) {
+		TEST_CHECK(riosockets_buffer_fanout(server, clientAddresses, 0, 16) == nullptr);
+		TEST_CHECK(riosockets_buffer_fanout(server, clientAddresses, 3, 513) == nullptr);
+
+		int delivered = 0;
+		int expected = 0;
+
+		for (int round = 0; round < 100; round++) {
+			int queued = 0;
+
+			// Several payloads are queued at once, the ring fits only a few of them so the allocations wrap while sends are in flight
+
+			for (int i = 0; i < TEST_ROUNDS && queued < 4; i++) {
+				uint8_t* buffer = riosockets_buffer_fanout(server, clientAddresses, 3, 400);
+
+				if (buffer == nullptr) {
+					if (queued > 0)
+						break;
+
+					riosockets_send(server);
+
+					continue;
+				}
+
+				test_fill(buffer, 400, round * 4 + queued++);
+			}
+
+			TEST_CHECK(queued > 0);
+
+			expected += queued * 3;
+
+			for (int i = 0; i < 3; i++) {
+				RioMessage messages[4];
+				int messageCount = test_receive(clients[i], server, messages, queued);
+
+				for (int j = 0; j < messageCount; j++) {
+					if (messages[j].dataLength == 400 && test_verify(messages[j].data, 400, round * 4 + j) && messages[j].address.port == serverAddress.port)
+						++delivered;
+				}
+
+				riosockets_release_batch(clients[i], messages, messageCount);
+			}
+		}
+
+		TEST_CHECK(delivered == expected && expected >= 300);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	for (RioSocket& client : clients) {
+		if (client != 0)
+			riosockets_destroy(&client);
+	}
+}
+
+// A body segment outlives the release of its owner while messages referencing it are queued, and returns once they are completed
+
+static void test_gather_lifetime() {
+	RioOptions options = test_options(1024, 64 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.maxSegments = 4;
+
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[12];
+
+	if (server != 0 && client != 0) {
+		int segments[4];
+
+		for (int i = 0; i < 4; i++) {
+			uint8_t* segment = riosockets_segment(client, 200, &segments[i]);
+
+			TEST_CHECK(segment != nullptr);
+
+			if (segment != nullptr)
+				test_fill(segment, 200, 50 + i);
+		}
+
+		int spare = -1;
+
+		TEST_CHECK(riosockets_segment(client, 200, &spare) == nullptr);
+		TEST_CHECK(riosockets_segment(client, 1025, &spare) == nullptr);
+
+		// Each message carries a header and two of the segments, every segment is referenced by several messages
+
+		for (int i = 0; i < 12; i++) {
+			int parts[2] = { segments[i % 4], segments[(i + 1) % 4] };
+			uint8_t* header = riosockets_buffer_gather(client, &serverAddress, 8, parts, 2);
+
+			TEST_CHECK(header != nullptr);
+
+			if (header != nullptr)
+				test_fill(header, 8, i);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			riosockets_segment_release(client, segments[i]);
+		}
+
+		TEST_CHECK(riosockets_segment(client, 200, &spare) == nullptr);
+
+		int messageCount = test_receive(server, client, messages, 12);
+
+		TEST_CHECK(messageCount == 12);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength == 8 + 200 * 2);
+			TEST_CHECK(test_verify(messages[i].data, 8, i));
+			TEST_CHECK(test_verify(messages[i].data + 8, 200, 50 + i % 4));
+			TEST_CHECK(test_verify(messages[i].data + 208, 200, 50 + (i + 1) % 4));
+		}
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		int acquired = 0;
+
+		for (int i = 0; i < TEST_ROUNDS && acquired < 4; i++) {
+			riosockets_send(client);
+
+			if (riosockets_segment(client, 200, &segments[acquired]) != nullptr)
+				++acquired;
+		}
+
+		TEST_CHECK(acquired == 4);
+
+		for (int i = 0; i < acquired; i++) {
+			riosockets_segment_release(client, segments[i]);
+		}
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Zero-copy messages hold their memory until the kernel notifies the completion, a ring cycled many times is reclaimed in full and never delivers overwritten data
+
+static void test_zerocopy_completion() {
+	RioOptions options = test_options(8192, 1024 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket server = test_socket(options, &serverAddress);
+
+	options.sendBufferSize = 64 * 1024;
+	options.flags = RIOSOCKETS_FLAG_ZEROCOPY;
+	options.zeroCopyThreshold = 4096;
+
+	RioSocket client = test_socket(options, &clientAddress);
+	RioMessage messages[16];
+
+	if (server != 0 && client != 0) {
+		int capacity = 0;
+		int zeroCopied = 0;
+
+		while (capacity < 16 && riosockets_buffer(client, &serverAddress, 8000) != nullptr) {
+			++capacity;
+		}
+
+		TEST_CHECK(capacity > 1);
+
+		int messageCount = test_receive(server, client, messages, capacity);
+
+		TEST_CHECK(messageCount == capacity);
+
+		riosockets_release_batch(server, messages, messageCount);
+
+		for (int round = 0; round < 30; round++) {
+			int queued = 0;
+
+			// The whole ring is available again only after the notifications of the previous round arrived
+
+			for (int i = 0; i < TEST_ROUNDS && queued < capacity; i++) {
+				int dataLength = (queued % 2 == 0 ? 8000 : 100);
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, dataLength);
+
+				if (buffer == nullptr) {
+					riosockets_send(client);
+
+					continue;
+				}
+
+				test_fill(buffer, dataLength, round + queued);
+
+				if (dataLength >= 4096)
+					++zeroCopied;
+
+				++queued;
+			}
+
+			TEST_CHECK(queued == capacity);
+
+			messageCount = test_receive(server, client, messages, queued);
+
+			TEST_CHECK(messageCount == queued);
+
+			for (int i = 0; i < messageCount; i++) {
+				TEST_CHECK(messages[i].dataLength == (i % 2 == 0 ? 8000 : 100));
+				TEST_CHECK(test_verify(messages[i].data, messages[i].dataLength, round + i));
+			}
+
+			riosockets_release_batch(server, messages, messageCount);
+		}
+
+		#if !defined(_WIN32) && !defined(RIOSOCKETS_NO_STATS)
+			RioStats stats = { };
+
+			TEST_CHECK(riosockets_get_stats(client, &stats) == RIOSOCKETS_STATUS_OK);
+			TEST_CHECK(stats.zeroCopyMessages == (uint64_t)(zeroCopied + capacity));
+			TEST_CHECK(stats.sendFailures == 0);
+		#endif
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+// Paced messages are spread over time at the rate of each destination and keep their order per destination
+
+static void test_pacing_order() {
+	RioOptions options = test_options(1024, 256 * 1024);
+	RioAddress clientAddress = { };
+	RioAddress serverAddresses[2] = { };
+	RioSocket servers[2] = { };
+
+	for (int i = 0; i < 2; i++) {
+		servers[i] = test_socket(options, &serverAddresses[i]);
+	}
+
+	options.pacingRate = 200000;
+	options.pacingBurst = 1000;
+
+	RioSocket client = test_socket(options, &clientAddress);
+
+	if (servers[0] != 0 && servers[1] != 0 && client != 0) {
+		int expected[2] = { };
+		int invalid = 0;
+
+		for (int i = 0; i < 40; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddresses[i % 2], 500);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 500, i / 2);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		while (expected[0] + expected[1] < 40 && std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+			riosockets_send(client);
+
+			for (int i = 0; i < 2; i++) {
+				RioMessage messages[20];
+				int messageCount = riosockets_receive_batch(servers[i], messages, 20);
+
+				for (int j = 0; j < messageCount; j++) {
+					if (messages[j].dataLength != 500 || !test_verify(messages[j].data, 500, expected[i]))
+						++invalid;
+
+					++expected[i];
+				}
+
+				if (messageCount > 0)
+					riosockets_release_batch(servers[i], messages, messageCount);
+			}
+		}
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		TEST_CHECK(expected[0] == 20 && expected[1] == 20);
+		TEST_CHECK(invalid == 0);
+
+		// 10000 bytes per destination with a burst of 1000 take 45 ms at the rate, the destinations are paced in parallel
+
+		TEST_CHECK(elapsed >= std::chrono::milliseconds(35));
+		TEST_CHECK(elapsed < std::chrono::milliseconds(1000));
+
+		#ifndef RIOSOCKETS_NO_STATS
+			RioStats stats = { };
+
+			TEST_CHECK(riosockets_get_stats(client, &stats) == RIOSOCKETS_STATUS_OK);
+			TEST_CHECK(stats.pacedMessages > 0);
+		#endif
+	}
+
+	for (RioSocket& server : servers) {
+		if (server != 0)
+			riosockets_destroy(&server);
+	}
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+static int executorReceived;
+static int executorCancelled;
+
+inline static uint32_t test_read32(const uint8_t* data) {
+	uint32_t value;
+
+	memcpy(&value, data, sizeof(value));
+
+	return value;
+}
+
+// Received and sent messages are recorded as well-formed pcapng packet blocks, and the file is cut to the recorded blocks when the socket is destroyed
+
+static void test_capture_file() {
+	const char* path = "riosockets_tests_capture.pcapng";
+	RioOptions options = test_options(256, 64 * 1024);
+	RioAddress serverAddress = { };
+	RioAddress clientAddress = { };
+	RioSocket client = test_socket(options, &clientAddress);
+
+	options.captureFile = path;
+	options.captureSize = 1024 * 1024;
+	options.flags = RIOSOCKETS_FLAG_CAPTURE_SEND;
+
+	RioSocket server = test_socket(options, &serverAddress);
+	RioMessage messages[10];
+
+	if (server != 0 && client != 0) {
+		for (int i = 0; i < 10; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &serverAddress, 20 + i);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 20 + i, i);
+		}
+
+		TEST_CHECK(test_receive(server, client, messages, 10) == 10);
+
+		riosockets_release_batch(server, messages, 10);
+
+		for (int i = 0; i < 5; i++) {
+			uint8_t* buffer = riosockets_buffer(server, &clientAddress, 40 + i);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 40 + i, 10 + i);
+		}
+
+		TEST_CHECK(test_receive(client, server, messages, 5) == 5);
+
+		riosockets_release_batch(client, messages, 5);
+	}
+
+	if (server != 0)
+		riosockets_destroy(&server);
+
+	if (client != 0)
+		riosockets_destroy(&client);
+
+	std::FILE* file = std::fopen(path, "rb");
+
+	TEST_CHECK(file != nullptr);
+
+	if (file == nullptr)
+		return;
+
+	std::vector<uint8_t> data;
+	uint8_t chunk[4096];
+	size_t chunkLength;
+
+	while ((chunkLength = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		data.insert(data.end(), chunk, chunk + chunkLength);
+	}
+
+	std::fclose(file);
+	std::remove(path);
+
+	int inbound = 0;
+	int outbound = 0;
+	int invalid = 0;
+	size_t offset = 0;
+
+	TEST_CHECK(data.size() >= 12 && test_read32(data.data()) == 0x0A0D0D0A && test_read32(data.data() + 8) == 0x1A2B3C4D);
+
+	while (offset + 12 <= data.size()) {
+		uint32_t type = test_read32(&data[offset]);
+		uint32_t length = test_read32(&data[offset + 4]);
+
+		if (length < 12 || length % 4 != 0 || offset + length > data.size() || test_read32(&data[offset + length - 4]) != length)
+			break;
+
+		// Enhanced packet blocks carry an IPv6 and a UDP header in front of the payload, followed by the direction in the flags option
+
+		if (type == 6) {
+			uint32_t captureLength = test_read32(&data[offset + 20]);
+			const uint8_t* packet = &data[offset + 28];
+			int payloadLength = (int)captureLength - 48;
+			int seed = (payloadLength >= 40 ? 10 + payloadLength - 40 : payloadLength - 20);
+			uint32_t flags = test_read32(packet + ((captureLength + 3) & ~3u) + 4);
+
+			if ((packet[0] >> 4) != 6 || packet[6] != 17 || payloadLength < 0 || ((packet[44] << 8) | packet[45]) != payloadLength + 8 || !test_verify(packet + 48, payloadLength, seed))
+				++invalid;
+
+			if ((flags & 3) == 1)
+				++inbound;
+			else if ((flags & 3) == 2)
+				++outbound;
+		}
+
+		offset += length;
+	}
+
+	TEST_CHECK(offset == data.size());
+	TEST_CHECK(inbound == 10);
+	TEST_CHECK(outbound == 5);
+	TEST_CHECK(invalid == 0);
+}
+
+// Small messages to one destination share datagrams on the wire and arrive as separate messages in order, while receivers without the flag see the datagrams as they are
+
+static void test_bundle() {
+	RioOptions options = test_options(1200, 256 * 1024);
+	RioAddress receiverAddress = { };
+	RioAddress rawAddress = { };
+	RioAddress plainAddress = { };
+	RioAddress senderAddress = { };
+	RioSocket raw = test_socket(options, &rawAddress);
+	RioSocket plain = test_socket(options, &plainAddress);
+
+	options.flags = RIOSOCKETS_FLAG_BUNDLE;
+
+	RioSocket receiver = test_socket(options, &receiverAddress);
+	RioSocket sender = test_socket(options, &senderAddress);
+	RioMessage messages[64];
+
+	if (receiver != 0 && sender != 0 && raw != 0 && plain != 0) {
+		for (int i = 0; i < 60; i++) {
+			uint8_t* buffer = riosockets_buffer(sender, &receiverAddress, 20 + i % 7);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 20 + i % 7, i);
+		}
+
+		int messageCount = test_receive(receiver, sender, messages, 60);
+
+		TEST_CHECK(messageCount == 60);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength == 20 + i % 7 && test_verify(messages[i].data, messages[i].dataLength, i));
+		}
+
+		riosockets_release_batch(receiver, messages, messageCount);
+
+		#if !defined(_WIN32) && !defined(RIOSOCKETS_NO_STATS)
+			RioStats stats = { };
+
+			TEST_CHECK(riosockets_get_stats(receiver, &stats) == RIOSOCKETS_STATUS_OK && stats.bundledMessages > 0);
+			TEST_CHECK(riosockets_get_stats(sender, &stats) == RIOSOCKETS_STATUS_OK && stats.bundledMessages > 0);
+		#endif
+
+		// A receiver without the flag gets fewer and longer datagrams that carry the bundle header
+
+		for (int i = 0; i < 60; i++) {
+			uint8_t* buffer = riosockets_buffer(sender, &rawAddress, 20);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 20, i);
+		}
+
+		riosockets_send(sender);
+		riosockets_wait(raw, 20);
+
+		messageCount = test_receive(raw, sender, messages, 60, 50);
+
+		TEST_CHECK(messageCount > 0 && messageCount < 60);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(messages[i].dataLength > 20 && messages[i].data[0] == 0xB5);
+		}
+
+		riosockets_release_batch(raw, messages, messageCount);
+
+		// A datagram which isn't a bundle passes through the receiver with the flag untouched
+
+		uint8_t* buffer = riosockets_buffer(plain, &receiverAddress, 64);
+
+		if (buffer != nullptr)
+			test_fill(buffer, 64, 3);
+
+		TEST_CHECK(test_receive(receiver, plain, messages, 1) == 1);
+		TEST_CHECK(messages[0].dataLength == 64 && test_verify(messages[0].data, 64, 3));
+
+		riosockets_release_batch(receiver, messages, 1);
+	}
+
+	if (receiver != 0)
+		riosockets_destroy(&receiver);
+
+	if (sender != 0)
+		riosockets_destroy(&sender);
+
+	if (raw != 0)
+		riosockets_destroy(&raw);
+
+	if (plain != 0)
+		riosockets_destroy(&plain);
+}
+
+#ifndef _WIN32
+	// Counts the inboxes in shared memory that belong to a port
+
+	static int test_shm_inboxes(uint16_t port) {
+		char suffix[16];
+		int inboxCount = 0;
+		DIR* directory = opendir("/dev/shm");
+
+		if (directory == nullptr)
+			return 0;
+
+		snprintf(suffix, sizeof(suffix), "-%u", port);
+
+		while (struct dirent* entry = readdir(directory)) {
+			size_t nameLength = strlen(entry->d_name);
+			size_t suffixLength = strlen(suffix);
+
+			if (strncmp(entry->d_name, "riosockets-", 11) == 0 && nameLength > suffixLength && strcmp(entry->d_name + nameLength - suffixLength, suffix) == 0)
+				++inboxCount;
+		}
+
+		closedir(directory);
+
+		return inboxCount;
+	}
+
+	// Messages between sockets with inboxes bypass the kernel in both directions, share the receive path with UDP in turns, wake up a blocked receiver and the inbox goes away with its socket
+
+	static void test_shared_memory() {
+		RioOptions options = test_options(256, 256 * 1024);
+		RioAddress serverAddress = { };
+		RioAddress clientAddress = { };
+		RioAddress plainAddress = { };
+		RioSocket plain = test_socket(options, &plainAddress);
+
+		options.flags = RIOSOCKETS_FLAG_SHARED_MEMORY;
+
+		RioSocket server = test_socket(options, &serverAddress);
+		RioSocket client = test_socket(options, &clientAddress);
+		RioMessage messages[120];
+
+		if (server != 0 && client != 0 && plain != 0) {
+			TEST_CHECK(test_shm_inboxes(serverAddress.port) == 1);
+
+			for (int i = 0; i < 100; i++) {
+				uint8_t* buffer = riosockets_buffer(client, &serverAddress, 16 + i);
+
+				TEST_CHECK(buffer != nullptr);
+
+				if (buffer != nullptr)
+					test_fill(buffer, 16 + i, i);
+			}
+
+			riosockets_send(client);
+
+			for (int i = 0; i < 10; i++) {
+				uint8_t* buffer = riosockets_buffer(plain, &serverAddress, 8);
+
+				if (buffer != nullptr)
+					test_fill(buffer, 8, 200 + i);
+			}
+
+			riosockets_send(plain);
+
+			// The datagrams are given time to arrive, so the turns between both sources can be observed
+
+			riosockets_wait(plain, 20);
+
+			int messageCount = test_receive(server, 0, messages, 110);
+			int shared = 0;
+			int firstPlain = -1;
+
+			TEST_CHECK(messageCount == 110);
+
+			for (int i = 0; i < messageCount; i++) {
+				if (messages[i].address.port == plainAddress.port) {
+					if (firstPlain < 0)
+						firstPlain = i;
+
+					TEST_CHECK(messages[i].dataLength == 8);
+				} else {
+					TEST_CHECK(messages[i].address.port == clientAddress.port);
+					TEST_CHECK(messages[i].dataLength == 16 + shared && test_verify(messages[i].data, messages[i].dataLength, shared));
+
+					++shared;
+				}
+			}
+
+			TEST_CHECK(shared == 100);
+			TEST_CHECK(firstPlain >= 0 && firstPlain < 10);
+
+			riosockets_release_batch(server, messages, messageCount);
+
+			// A reply to the address of a message from shared memory takes the same path
+
+			uint8_t* buffer = riosockets_buffer(server, &clientAddress, 32);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 32, 7);
+
+			TEST_CHECK(test_receive(client, server, messages, 1) == 1);
+			TEST_CHECK(test_verify(messages[0].data, 32, 7));
+
+			riosockets_release_batch(client, messages, 1);
+
+			#ifndef RIOSOCKETS_NO_STATS
+				RioStats stats = { };
+				uint64_t batches = 0;
+
+				TEST_CHECK(riosockets_get_stats(client, &stats) == RIOSOCKETS_STATUS_OK);
+
+				for (uint64_t batchCount : stats.completionBatches) {
+					batches += batchCount;
+				}
+
+				TEST_CHECK(batches == 0);
+			#endif
+
+			// A receiver blocked in the wait is woken up by a sender that publishes into its inbox
+
+			std::thread sender([&]() {
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+				uint8_t* delayed = riosockets_buffer(client, &serverAddress, 16);
+
+				if (delayed != nullptr)
+					test_fill(delayed, 16, 9);
+
+				riosockets_send(client);
+			});
+
+			auto start = std::chrono::steady_clock::now();
+			int waitResult = riosockets_wait(server, 5000);
+			auto elapsed = std::chrono::steady_clock::now() - start;
+
+			sender.join();
+
+			TEST_CHECK(waitResult == 1);
+			TEST_CHECK(elapsed >= std::chrono::milliseconds(50) && elapsed < std::chrono::milliseconds(2000));
+			TEST_CHECK(test_receive(server, 0, messages, 1) == 1);
+			TEST_CHECK(test_verify(messages[0].data, 16, 9));
+
+			riosockets_release_batch(server, messages, 1);
+		}
+
+		uint16_t serverPort = serverAddress.port;
+
+		if (server != 0)
+			riosockets_destroy(&server);
+
+		if (client != 0)
+			riosockets_destroy(&client);
+
+		if (plain != 0)
+			riosockets_destroy(&plain);
+
+		TEST_CHECK(test_shm_inboxes(serverPort) == 0);
+	}
+#endif
+
+static riosockets::Task test_executor_receive(riosockets::Socket& socket, riosockets::Executor& executor) {
+	riosockets::Message message = co_await socket.receive();
+
+	executorReceived = message.length();
+	executor.stop();
+}
+
+struct TestCancellation {
+	~TestCancellation() {
+		++executorCancelled;
+	}
+};
+
+static riosockets::Task test_executor_cancelled(riosockets::Socket& socket) {
+	TestCancellation cancellation;
+	riosockets::Message message = co_await socket.receive();
+
+	executorCancelled += 100;
+}
+
+static riosockets::Task test_executor_close(std::unique_ptr<riosockets::Socket>& socket, riosockets::Executor& executor) {
+	socket.reset();
+	executor.stop();
+
+	co_return;
+}
+
+// The executor sleeps while no coroutine can make progress, and destroying a socket cancels the coroutines that wait on it
+
+static void test_executor_wait() {
+	riosockets::Executor executor;
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = test_options(1024, 65536);
+	RioAddress address = { };
+	RioAddress clientAddress = { };
+
+	riosockets::Socket server(executor, options, &error);
+
+	TEST_CHECK(server);
+
+	if (!server)
+		return;
+
+	riosockets_address_set_ip(&address, "::1");
+
+	TEST_CHECK(server.bind(address) == 0);
+	TEST_CHECK(riosockets_address_get(server.native(), &address) == RIOSOCKETS_STATUS_OK);
+
+	executor.spawn(test_executor_receive(server, executor));
+
+	std::thread sender([&]() {
+		RioSocket client = test_socket(options, &clientAddress);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+		if (client == 0)
+			return;
+
+		uint8_t* buffer = riosockets_buffer(client, &address, 10);
+
+		if (buffer != nullptr)
+			test_fill(buffer, 10, 0);
+
+		riosockets_send(client);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		riosockets_destroy(&client);
+	});
+
+	std::clock_t processor = std::clock();
+	auto start = std::chrono::steady_clock::now();
+
+	executor.run();
+
+	double processorTime = (double)(std::clock() - processor) / CLOCKS_PER_SEC;
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	sender.join();
+
+	TEST_CHECK(executorReceived == 10);
+	TEST_CHECK(elapsed >= 0.15);
+	TEST_CHECK(processorTime < elapsed / 2);
+
+	auto closing = std::make_unique<riosockets::Socket>(executor, options, &error);
+
+	TEST_CHECK(*closing);
+
+	if (!*closing)
+		return;
+
+	executor.spawn(test_executor_cancelled(*closing));
+	executor.spawn(test_executor_cancelled(*closing));
+	executor.spawn(test_executor_close(closing, executor));
+
+	TEST_CHECK(executorCancelled == 2);
+	TEST_CHECK(closing == nullptr);
+}
+
+// A socket that failed to create must report it and destruct without touching the library
+
+static void test_socket_invalid_options() {
+	riosockets::Executor executor;
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = { };
+
+	options.maxBufferLength = 1024;
+	options.sendBufferSize = 65536;
+	options.receiveBufferSize = 65536;
+
+	riosockets::Socket valid(executor, options, &error);
+
+	TEST_CHECK(valid);
+
+	options.maxBufferLength = 0;
+
+	{
+		riosockets::Socket socket(executor, options, &error);
+
+		TEST_CHECK(!socket);
+		TEST_CHECK(socket.native() == 0);
+		TEST_CHECK(error != RIOSOCKETS_ERROR_NONE);
+
+		executor.poll();
+	}
+
+	executor.poll();
+}
+
+struct TestHandler {
+	int received = 0;
+	int mismatched = 0;
+
+	template <typename Socket>
+	void operator()(Socket&, const RioMessage&) noexcept {
+		++received;
+	}
+
+	template <typename Socket>
+	void mismatch(Socket&, const RioMessage&) noexcept {
+		++mismatched;
+	}
+};
+
+struct TestFixedTraits : riosockets::SocketTraits {
+	static constexpr int messageLength = 16;
+};
+
+static void test_template_invalid_options() {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = { };
+
+	options.sendBufferSize = 65536;
+	options.receiveBufferSize = 65536;
+	options.maxBufferLength = -1;
+
+	riosockets::SocketT<TestHandler> socket(options, &error);
+
+	TEST_CHECK(!socket);
+	TEST_CHECK(socket.native() == 0);
+	TEST_CHECK(error != RIOSOCKETS_ERROR_NONE);
+}
+
+// Messages of another length than the fixed one reach the mismatch member and the counter instead of vanishing
+
+static void test_template_mismatch() {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = { };
+	RioAddress address = { };
+
+	options.maxBufferLength = 64;
+	options.sendBufferSize = 65536;
+	options.receiveBufferSize = 65536;
+
+	riosockets::SocketT<TestHandler, TestFixedTraits> server(options, &error);
+	RioSocket client = riosockets_create(64, 65536, 65536, test_callback, &error);
+
+	TEST_CHECK(server);
+	TEST_CHECK(client > 0);
+
+	if (!server || client <= 0)
+		return;
+
+	riosockets_address_set_ip(&address, "::1");
+
+	TEST_CHECK(server.bind(address) == 0);
+	TEST_CHECK(riosockets_address_get(server.native(), &address) == RIOSOCKETS_STATUS_OK);
+
+	int lengths[] = { 16, 20, 16, 8 };
+
+	for (int length : lengths) {
+		uint8_t* buffer = riosockets_buffer(client, &address, length);
+
+		TEST_CHECK(buffer != nullptr);
+
+		if (buffer != nullptr)
+			memset(buffer, 0, length);
+	}
+
+	riosockets_send(client);
+
+	for (int i = 0; i < 100000 && server.handler().received + server.handler().mismatched < 4; i++) {
+		riosockets_send(client);
+		server.receive();
+	}
+
+	TEST_CHECK(server.handler().received == 2);
+	TEST_CHECK(server.handler().mismatched == 2);
+	TEST_CHECK(server.mismatchedMessages() == 2);
+
+	riosockets_destroy(&client);
+}
+
+struct TestLeanTraits : riosockets::SocketTraits {
+	static constexpr bool stats = false;
+	static constexpr bool peers = false;
+	static constexpr bool coalescing = false;
+	static constexpr bool bundle = false;
+	static constexpr bool sharedMemory = false;
+};
+
+// A template without optional features refuses options that need them and receives through its specialized loop, the C functions refuse to leave out a feature in use
+
+static void test_template_features() {
+	RioError error = RIOSOCKETS_ERROR_NONE;
+	RioOptions options = test_options(64, 65536);
+	RioAddress address = { };
+	RioAddress clientAddress = { };
+
+	options.callback = nullptr;
+	options.flags = RIOSOCKETS_FLAG_GRO;
+
+	{
+		riosockets::SocketT<TestHandler, TestLeanTraits> socket(options, &error);
+
+		TEST_CHECK(!socket);
+		TEST_CHECK(error == RIOSOCKETS_ERROR_OPTIONS);
+	}
+
+	options.flags = RIOSOCKETS_FLAG_NONE;
+	error = RIOSOCKETS_ERROR_NONE;
+
+	riosockets::SocketT<TestHandler, TestLeanTraits> server(options, &error);
+
+	options.callback = test_callback;
+	options.maxPeers = 4;
+
+	RioSocket client = test_socket(options, &clientAddress);
+
+	TEST_CHECK(server);
+
+	if (server && client != 0) {
+		riosockets_address_set_ip(&address, "::1");
+
+		TEST_CHECK(server.bind(address) == 0);
+		TEST_CHECK(riosockets_address_get(server.native(), &address) == RIOSOCKETS_STATUS_OK);
+
+		for (int i = 0; i < 8; i++) {
+			uint8_t* buffer = server.buffer(clientAddress, 16);
+
+			TEST_CHECK(buffer != nullptr);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 16, i);
+		}
+
+		RioMessage messages[8];
+		int messageCount = test_receive(client, server.native(), messages, 8);
+
+		TEST_CHECK(messageCount == 8);
+
+		for (int i = 0; i < messageCount; i++) {
+			TEST_CHECK(test_verify(messages[i].data, 16, i));
+		}
+
+		riosockets_release_batch(client, messages, messageCount);
+
+		for (int i = 0; i < 8; i++) {
+			uint8_t* buffer = riosockets_buffer(client, &address, 16);
+
+			if (buffer != nullptr)
+				test_fill(buffer, 16, i);
+		}
+
+		for (int i = 0; i < TEST_ROUNDS && server.handler().received < 8; i++) {
+			riosockets_send(client);
+			server.receive();
+		}
+
+		TEST_CHECK(server.handler().received == 8);
+		TEST_CHECK(riosockets_receive_batch_ex(client, messages, 8, RIOSOCKETS_FEATURE_NONE) < 0);
+		TEST_CHECK(riosockets_receive_batch_ex(client, messages, 8, RIOSOCKETS_FEATURE_PEERS) == 0);
+		TEST_CHECK(riosockets_buffer_ex(client, &address, 16, RIOSOCKETS_FEATURE_STATS) == nullptr);
+	}
+
+	if (client != 0)
+		riosockets_destroy(&client);
+}
+
+#ifndef _WIN32
+	// A shard whose socket can't be created fails the server with an error code instead of using an invalid handle
+
+	static void test_server_invalid_callback() {
+		RioError error = RIOSOCKETS_ERROR_NONE;
+		RioServerOptions options = { };
+
+		options.options.maxBufferLength = 1024;
+		options.options.sendBufferSize = 65536;
+		options.options.receiveBufferSize = 65536;
+		options.shardCount = 1;
+
+		riosockets_address_set_ip(&options.address, "::1");
+
+		RioServer server = riosockets_server_create(&options, &error);
+
+		TEST_CHECK(server == -1);
+		TEST_CHECK(error == RIOSOCKETS_ERROR_OPTIONS);
+	}
+#endif
+
+int main() {
+	if (riosockets_initialize() != RIOSOCKETS_STATUS_OK) {
+		fprintf(stderr, "Initialization failed\n");
+
+		return 1;
+	}
+
+	test_round_trip();
+	test_ring_wrap();
+	test_send_batch();
+	test_create_options();
+	test_gso_coalescing();
+	test_gro_splitting();
+	test_batch_limit();
+	test_batch_release();
+	test_callback_retain();
+	test_packed_wrap();
+	test_concurrent_send();
+	test_pool_quota();
+	test_peer_registry();
+	test_fanout_lifetime();
+	test_gather_lifetime();
+	test_zerocopy_completion();
+	test_pacing_order();
+	test_capture_file();
+
+	#ifndef _WIN32
+		test_shared_memory();
+	#endif
+
+	test_bundle();
+
+	test_executor_wait();
+	test_socket_invalid_options();
+	test_template_invalid_options();
+	test_template_mismatch();
+	test_template_features();
+
+	#ifndef _WIN32
+		test_server_invalid_callback();
+	#endif
+
+	riosockets_deinitialize();
+
+	if (failures != 0)
+		fprintf(stderr, "%d checks failed\n", failures);
+
+	return failures != 0;
+}